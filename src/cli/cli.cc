@@ -1,14 +1,22 @@
 #include "cli.h"
+#include "input.h"
+#include "dispatch.h"
+#include "analysis.h"
+#include "dot.h"
+#include "report.h"
+#include "kinship.h"
+#include "parallel.h"
 
 #include <iostream>
 #include <fstream>
 #include <cstdio>
 #include <unistd.h>
 #include <set>
+#include <cassert>
+#include <algorithm>
 
 namespace genea {
 
-
 std::string CLI::banner =
 "      ....        .                                                   \n"
 "   .x88\" `^x~  xH(`                                                   \n"
@@ -24,24 +32,8 @@ std::string CLI::banner =
 "      ^\"~====\"\"`         \"YP'                     \"YP'     ^Y\"   ^Y'  \n";
 
 
-CLI::CLI(const std::string& file):
-current_(nullptr),
-people_(std::vector<std::shared_ptr<struct Person>>()),
-commands_({
-  { "help", std::bind(&CLI::help, this, std::placeholders::_1) },
-  { "create", std::bind(&CLI::create, this, std::placeholders::_1) },
-  { "add", std::bind(&CLI::add, this, std::placeholders::_1) },
-  { "attach", std::bind(&CLI::attach, this, std::placeholders::_1) },
-  { "remove", std::bind(&CLI::remove, this, std::placeholders::_1) },
-  { "overwrite", std::bind(&CLI::overwrite, this, std::placeholders::_1) },
-  { "info", std::bind(&CLI::info, this, std::placeholders::_1) },
-  { "list", std::bind(&CLI::list, this, std::placeholders::_1) },
-  { "search", std::bind(&CLI::search, this, std::placeholders::_1) },
-  { "select", std::bind(&CLI::select, this, std::placeholders::_1) },
-  { "dump", std::bind(&CLI::dump, this, std::placeholders::_1) },
-  { "load", std::bind(&CLI::load, this, std::placeholders::_1)},
-  { "generate-image", std::bind(&CLI::generateImage, this, std::placeholders::_1) }
-}) {
+CLI::CLI(const std::string& file, bool lazy):
+current_(nullptr) {
   if (isatty(STDIN_FILENO))
     std::cerr << banner << std::endl;
   if (file == "") {
@@ -55,47 +47,172 @@ commands_({
     std::cout << "Created empty tree" << std::endl;
     return;
   }
-  std::vector<std::shared_ptr<struct Person>> people = utils::parseFile(f);
-  if (!people.size()) {
+  f.close();
+  Result<size_t> opened = tree_.open(file, lazy);
+  if (!opened) {
+    std::cerr << opened.error << std::endl;
     std::cerr << "Warning: file " << file << " is corrupted/incorrect" << std::endl;
     std::cout << "Created empty tree" << std::endl;
     return;
   }
-  people_ = people;
-  int i = 0;
-  for (auto& person : people_) {
-    person->id = i;
-    i++;
-  }
-  current_ = people_[0];
+  std::cout << (tree_.lazy() ? "Indexed " : "Loaded ") << opened.value << " people" << std::endl;
+  current_ = tree_.person(0);
   std::cout << "Tree loaded from " << file << std::endl;
   std::cout << "(Cursor set to person ID 0)" << std::endl;
 }
 
 void CLI::run() {
-  if (isatty(STDIN_FILENO))
+  Input input(STDIN_FILENO);
+  if (input.interactive())
     std::cerr << PS1;
 
-  std::string line;
-  std::getline(std::cin, line);
-
-  bool exit = false;
-
-  while (!std::cin.eof() && !exit) {
-    std::vector<std::string> command = utils::parseLine(line, ' ');
+  commandArgs command;
+  std::vector<std::string_view> background;
+  while (input.next(command)) {
+    // a trailing '&' runs the command as a job
+    if (command.size() > 1 && command.back() == "&") {
+      background.assign({ "job", "run" });
+      background.insert(background.end(), command.begin(), command.end() - 1);
+      command = background;
+    }
     if (command.size()) {
-      std::string arg0 = command[0];
-      if (!commands_.contains(arg0)) {
-        std::cerr << "Unknown command: " << arg0 << std::endl;
+      const Command* run = CLI::command(command[0]);
+      if (!run) {
+        std::cerr << "Unknown command: " << command[0] << std::endl;
         std::cerr << "Type 'help' to obtain help a list of available commands" << std::endl;
       } else {
-        commands_[arg0](std::vector<std::string>(command.begin() + 1, command.end()));
+        (this->**run)(command.subspan(1));
       }
     }
-    if (isatty(STDIN_FILENO))
+    for (int id : tree_.evict())
+      std::cerr << "Warning: record " << id << " is corrupted" << std::endl;
+    jobs_.report();
+    if (input.interactive())
       std::cerr << PS1;
-    std::getline(std::cin, line);
   }
+  jobs_.waitAll();
+}
+
+const CLI::Command* CLI::command(std::string_view name) {
+  static constexpr std::pair<std::string_view, Command> commands[] = {
+    { "help", &CLI::help },
+    { "create", &CLI::create },
+    { "add", &CLI::add },
+    { "attach", &CLI::attach },
+    { "remove", &CLI::remove },
+    { "overwrite", &CLI::overwrite },
+    { "info", &CLI::info },
+    { "list", &CLI::list },
+    { "search", &CLI::search },
+    { "find", &CLI::find },
+    { "analyze", &CLI::analyze },
+    { "collapse", &CLI::collapse },
+    { "report", &CLI::report },
+    { "relate", &CLI::relate },
+    { "select", &CLI::select },
+    { "dump", &CLI::dump },
+    { "load", &CLI::load },
+    { "hash", &CLI::hash },
+    { "diff", &CLI::diff },
+    { "patch", &CLI::patch },
+    { "fsck", &CLI::fsck },
+    { "generate-image", &CLI::generateImage },
+    { "workspace", &CLI::workspace },
+    { "mem", &CLI::mem },
+    { "jobs", &CLI::jobs },
+    { "job", &CLI::job }
+  };
+  static constexpr utils::PerfectHash<Command, std::size(commands)> table(commands);
+  return table.find(name);
+}
+
+// leading "--format <text|tsv|json>" option of the commands printing people
+bool CLI::formatOption(const std::string& command, commandArgs& args, Format* format) {
+  if (args.empty() || args[0] != "--format")
+    return true;
+  if (args.size() < 2 || !output::parseFormat(args[1], format)) {
+    std::cerr << command << ": format must be either text, tsv or json" << std::endl;
+    return false;
+  }
+  args = args.subspan(2);
+  return true;
+}
+
+/*
+ * Leading "--from <relation|id>", "--ancestors <n>", "--descendants <n>" and
+ * "--with-spouses" options of the commands writing a branch, from the cursor
+ * unless given. The branch has no start when there are none
+ */
+bool CLI::branchOptions(const std::string& command, commandArgs& args, Branch* branch) {
+  bool given = false;
+  while (args.size()) {
+    if (args[0] == "--with-spouses") {
+      branch->spouses = true;
+      args = args.subspan(1);
+    } else if ((args[0] == "--ancestors" || args[0] == "--descendants") && args.size() > 1) {
+      int n = utils::parseId(args[1]);
+      if (n < 0) {
+        std::cerr << command << ": " << args[1] << " is not a valid number of generations" << std::endl;
+        return false;
+      }
+      (args[0] == "--ancestors" ? branch->ancestors : branch->descendants) = n;
+      args = args.subspan(2);
+    } else if (args[0] == "--from" && args.size() > 1) {
+      int id = utils::parseId(args[1]);
+      if (id < 0 || (size_t)id >= tree_.size()) {
+        if (!current_) {
+          std::cerr << command << ": " << args[1] << " is not a valid ID" << std::endl;
+          return false;
+        }
+        auto p = relation(args[1]);
+        if (p.size() != 1) {
+          if (p.size())
+            std::cerr << command << ": Can't start from a grouping relation" << std::endl;
+          return false;
+        }
+        id = p[0]->id;
+      }
+      branch->from = id;
+      args = args.subspan(2);
+    } else {
+      break;
+    }
+    given = true;
+  }
+  if (given && branch->from == -1) {
+    if (!current_) {
+      std::cerr << command << ": You must create at least one person before. Your cursor is nobody!" << std::endl;
+      return false;
+    }
+    branch->from = current_->id;
+  }
+  return true;
+}
+
+// relation chains from the cursor, errors are printed
+std::vector<std::shared_ptr<struct Person>> CLI::relation(std::string_view relations) {
+  Result<std::vector<std::shared_ptr<struct Person>>> res = tree_.relation(current_, relations);
+  if (!res)
+    std::cerr << res.error << std::endl;
+  return res.value;
+}
+
+// changes copy the people shared with a fork, the cursor follows its copy
+void CLI::follow() {
+  if (current_)
+    current_ = tree_.person(current_->id);
+}
+
+void CLI::switchTo(const std::string& name) {
+  Workspace& stashed = workspaces_[workspace_];
+  stashed.tree = std::move(tree_);
+  stashed.current = std::move(current_);
+  auto it = workspaces_.find(name);
+  tree_ = std::move(it->second.tree);
+  current_ = std::move(it->second.current);
+  workspaces_.erase(it);
+  workspace_ = name;
+  std::cout << "Switched to workspace " << name << std::endl;
 }
 
 /* commands */
@@ -105,6 +222,7 @@ void CLI::help(commandArgs args) {
   // General commands
   std::cerr << std::endl << "General commands:" << std::endl;
   std::cerr << "\t help\t\t\t\t\t Displays this message" << std::endl;
+  std::cerr << "\t mem\t\t\t\t\t Displays the memory used by people, names, links, indexes, caches and traversals" << std::endl;
 
   // Creation/Deletion commands
   std::cerr << std::endl << "Creation/Deletion commands:" << std::endl;
@@ -126,6 +244,22 @@ void CLI::help(commandArgs args) {
   std::cerr << "\t info <id>\t\t\t\t Displays information about the person whose ID is <id>" << std::endl;
   std::cerr << "\t list\t\t\t\t\t Displays a list of all people of the tree with their given ID" << std::endl;
   std::cerr << "\t search <name>\t\t\t\t Displays all the people whose first name or last name matches <name>" << std::endl;
+  std::cerr << "\t search --contains <text>\t\t Displays all the people whose first name or last name contains <text>" << std::endl;
+  std::cerr << "\t\t\t\t\t\t With -i, search ignores case" << std::endl;
+  std::cerr << "\t find <term>... [sort=[-]<field>] [limit=<n>]" << std::endl;
+  std::cerr << "\t\t\t\t\t\t Displays all the people matching every term, a term is <field><op><value>" << std::endl;
+  std::cerr << "\t\t\t\t\t\t (first, last, name with =, != or ~; sex; born, died with =, !=, <, <=, >, >=;" << std::endl;
+  std::cerr << "\t\t\t\t\t\t has=father|mother|children|spouse|birth|death; in=<relation>|ancestors|descendants)" << std::endl;
+  std::cerr << "\t\t\t\t\t\t A term preceded by 'not' is negated. With --explain, the access path is printed" << std::endl;
+  std::cerr << "\t analyze [--surnames <n>] [<id>]\t Displays counts by generation (ranked from the current person or <id>)," << std::endl;
+  std::cerr << "\t\t\t\t\t\t the sex ratio, lifespans, children per couple and the <n> most frequent surnames" << std::endl;
+  std::cerr << "\t collapse <id> [<depth>]\t\t Displays the distinct ancestors of the person whose ID is <id> by generation," << std::endl;
+  std::cerr << "\t\t\t\t\t\t and the ancestors reached through several lines" << std::endl;
+  std::cerr << "\t report descendants <id> [<depth>]\t Lists the descendants of the person whose ID is <id> with d'Aboville numbers" << std::endl;
+  std::cerr << "\t report ancestors <id> [<depth>]\t Lists the ancestors of the person whose ID is <id> with Sosa numbers" << std::endl;
+  std::cerr << "\t relate <id1> <id2>\t\t\t Displays the shortest relation chain from <id1> to <id2>, usable with select," << std::endl;
+  std::cerr << "\t\t\t\t\t\t their kinship and their nearest common ancestors" << std::endl;
+  std::cerr << "\t\t\t\t\t\t info, list, search and find take a leading '--format <text|tsv|json>' option" << std::endl;
 
   // Move commands
   std::cerr << std::endl << "Move commands:" << std::endl;
@@ -135,10 +269,41 @@ void CLI::help(commandArgs args) {
   // Dump commands
   std::cerr << std::endl << "File commands:" << std::endl;
   std::cerr << "\t dump <file>\t\t\t\t Dumps the current tree to <file>" << std::endl;
+  std::cerr << "\t dump --archive <file>\t\t\t Dumps the current tree to <file> in the compact archival format" << std::endl;
+  std::cerr << "\t dump --from <relation|id> <file>\t Dumps only the branch of a person, with '--ancestors <n>' and '--descendants <n>'" << std::endl;
+  std::cerr << "\t\t\t\t\t\t generations and '--with-spouses' for the other parents of their children" << std::endl;
   std::cerr << "\t load <file>\t\t\t\t Loads the file <file> into the current tree" << std::endl;
+  std::cerr << "\t hash [<id>]\t\t\t\t Displays the digest of the tree, and the hashes of the person whose ID is <id>" << std::endl;
+  std::cerr << "\t\t\t\t\t\t and of their branch, which do not depend on IDs" << std::endl;
+  std::cerr << "\t diff <file a> <file b> [<patch>]\t Displays the people removed, added, changed or given other parents from <file a>" << std::endl;
+  std::cerr << "\t\t\t\t\t\t to <file b>, and writes the edits to <patch>" << std::endl;
+  std::cerr << "\t patch <patch>\t\t\t\t Applies <patch> to the current tree, which must be the one it was made from" << std::endl;
+  std::cerr << "\t fsck [--repair]\t\t\t Checks the sex of parents, cycles of parents, birth and death dates and the lists" << std::endl;
+  std::cerr << "\t\t\t\t\t\t of children, and repairs what can be with --repair" << std::endl;
   std::cerr << "\t generate-image <file>\t\t\t Generates a graph view of the genealogical tree to <file>" << std::endl;
+  std::cerr << "\t\t\t\t\t\t Ranks are ordered to limit crossings before graphviz runs, '--mclimit <factor>'" << std::endl;
+  std::cerr << "\t\t\t\t\t\t and '--remincross' tune what graphviz does on its own" << std::endl;
+  std::cerr << "\t\t\t\t\t\t '--tiled' splits it into tiles of at most 1000 people (or '--tile-size <n>')," << std::endl;
+  std::cerr << "\t\t\t\t\t\t rendered concurrently and linked from an HTML index" << std::endl;
   std::cerr << "\t\t\t\t\t\t The generated graph will not contain people that are not related to the current person" << std::endl;
   std::cerr << "\t\t\t\t\t\t (e.g loaded people or created & non-attached people)" << std::endl;
+  std::cerr << "\t\t\t\t\t\t Takes the branch options of dump to draw only a branch" << std::endl;
+
+  // Workspace commands
+  std::cerr << std::endl << "Workspace commands:" << std::endl;
+  std::cerr << "\t workspace\t\t\t\t Displays the workspaces, each holding its own tree and cursor" << std::endl;
+  std::cerr << "\t workspace new <name>\t\t\t Creates an empty workspace and switches to it" << std::endl;
+  std::cerr << "\t workspace fork <name>\t\t\t Creates a copy of the current workspace and switches to it" << std::endl;
+  std::cerr << "\t\t\t\t\t\t People are shared until either of them changes some, which copies only those" << std::endl;
+  std::cerr << "\t workspace switch <name>\t\t Switches to the workspace <name>" << std::endl;
+  std::cerr << "\t workspace drop <name>\t\t\t Deletes the workspace <name>" << std::endl;
+  // Job commands
+  std::cerr << std::endl << "Job commands:" << std::endl;
+  std::cerr << "\t <command> &\t\t\t\t Runs generate-image or dump in the background, on the tree as it is" << std::endl;
+  std::cerr << "\t job run <command>\t\t\t Same as <command> &" << std::endl;
+  std::cerr << "\t jobs\t\t\t\t\t Displays the jobs and their progress" << std::endl;
+  std::cerr << "\t job wait [<n>]\t\t\t\t Waits for the job <n>, or all of them, and displays its messages" << std::endl;
+  std::cerr << "\t job cancel <n>\t\t\t\t Stops the job <n>" << std::endl;
   // Relations
   std::cerr << std::endl << "Available relations are:" << std::endl;
   std::cerr << "\t father, mother, child:<first name>, sibling:<first name>, child (grouping), sibling (grouping)" << std::endl;
@@ -152,13 +317,14 @@ void CLI::create(commandArgs args) {
     std::cerr << "Usage:" << std::endl << "\t create <first name> <last name> <sex> <birth> [<death>]" << std::endl;
     return;
   }
-  std::shared_ptr<struct Person> created = utils::parsePerson(args);
-  if (!created) {
+  std::string error;
+  std::shared_ptr<struct Person> fields = utils::parsePerson(args, error);
+  if (!fields) {
+    std::cerr << error << std::endl;
     std::cerr << "create: Could not create person" << std::endl;
     return;
   }
-  created->id = people_.size();
-  people_.push_back(created);
+  std::shared_ptr<struct Person> created = tree_.create(*fields);
   std::cout << "Created person ID " << created->id << std::endl;
   if (!current_) {
     current_ = created;
@@ -176,29 +342,23 @@ void CLI::add(commandArgs args) {
     std::cerr << "Usage:" << std::endl << "\t add <relation> <first name> <last name> <sex> <birth> [<death>]" << std::endl;
     return;
   }
-  std::vector<std::string> relationChain = utils::parseLine(args[0], '.');
-  std::vector<std::shared_ptr<struct Person>> p = utils::computeRelation(std::vector<std::string>(relationChain.begin(), relationChain.end() - 1), current_);
-  if (!p.size()) {
-    std::cerr << "add: Could not get to that relation" << std::endl;
-    return;
-  }
-  if (p.size() > 1) {
-    std::cerr << "add: Grouping relation must be last" << std::endl;
-    return;
-  }
-  std::shared_ptr<struct Person> created = utils::parsePerson(std::vector<std::string>(args.begin() + 1, args.end()));
-  if (!created) {
+  std::string error;
+  std::shared_ptr<struct Person> fields = utils::parsePerson(args.subspan(1), error);
+  if (!fields) {
+    std::cerr << error << std::endl;
     std::cerr << "add: Could not create person" << std::endl;
     return;
   }
-  if (!utils::setRelation(relationChain.back(), p[0], created)) {
-    std::cerr << "add: Could not create relation" << std::endl;
+  Result<std::shared_ptr<struct Person>> created = tree_.add(current_, args[0], *fields);
+  follow();
+  if (!created.warning.empty())
+    std::cout << created.warning << std::endl;
+  if (!created) {
+    std::cerr << "add: " << created.error << std::endl;
     return;
   }
-  created->id = people_.size();
-  people_.push_back(created);
-  std::cout << "Created person ID " << created->id << std::endl;
-  created->info();
+  std::cout << "Created person ID " << created.value->id << std::endl;
+  created.value->info();
 }
 
 void CLI::attach(commandArgs args) {
@@ -210,35 +370,22 @@ void CLI::attach(commandArgs args) {
     std::cerr << "Usage:" << std::endl << "\t attach <relation> <id>" << std::endl << "\t attach <relation> <id1> <id2>" << std::endl;
     return;
   }
-  std::vector<std::string> relationChain = utils::parseLine(args[0], '.');
-  int id1 = utils::parseId(args[1]);
-  if (id1 < 0 || id1 >= people_.size()) {
-    std::cerr << "attach: " << args[1] << "is not a valid ID" << std::endl;
-    return;
-  }
-  std::vector<std::shared_ptr<struct Person>> p = utils::computeRelation(std::vector<std::string>(relationChain.begin(), relationChain.end() - 1), current_);
-  if (!p.size()) {
-    std::cerr << "attach: Could not get to that relation" << std::endl;
-    return;
-  }
-  if (p.size() > 1) {
-    std::cerr << "attach: Grouping relation must be last" << std::endl;
-    return;
-  }
-  if (args.size() == 3) {
-    int id2 = utils::parseId(args[2]);
-    if (id2 < 0 || id2 >= people_.size()) {
-      std::cerr << "attach: " << args[2] << "is not a valid ID" << std::endl;
+  int ids[2] = { -1, -1 };
+  for (size_t i = 1; i < args.size(); i++) {
+    ids[i - 1] = utils::parseId(args[i]);
+    if (ids[i - 1] < 0 || ids[i - 1] >= tree_.size()) {
+      std::cerr << "attach: " << args[i] << " is not a valid ID" << std::endl;
       return;
     }
-    if (!utils::setRelation(relationChain.back(), people_[id1], people_[id2])) {
-      std::cerr << "attach: Could not set relation" << std::endl;
-    }
-    return;
-  }
-  if (!utils::setRelation(relationChain.back(), current_, people_[id1])) {
-     std::cerr << "attach: Could not set relation" << std::endl;
   }
+  // attach <relation> <id1> <id2> sets <id2> as the relation of <id1>
+  std::shared_ptr<struct Person> from = args.size() == 3 ? tree_.person(ids[0]) : current_;
+  Status status = tree_.attach(from, args[0], tree_.person(ids[args.size() == 3 ? 1 : 0]));
+  follow();
+  if (!status.warning.empty())
+    std::cout << status.warning << std::endl;
+  if (!status)
+    std::cerr << "attach: " << status.error << std::endl;
 }
 
 void CLI::remove(commandArgs args) {
@@ -251,30 +398,26 @@ void CLI::remove(commandArgs args) {
     return;
   }
   int id = utils::parseId(args[0]);
-  if (id >= 0 && id < people_.size()) {
-    utils::rmRelation("father", people_[id]);
-    utils::rmRelation("mother", people_[id]);
-    while (people_[id]->children_.size()) {
-      utils::rmRelation("child:" + people_[id]->children_[0]->firstName_, people_[id]);
-    }
-    if (current_ == people_[id]) {
-      if (people_.size() == 1) {
+  if (id >= 0 && id < tree_.size()) {
+    // the id of the cursor once the ids after the person shift down
+    int cursor = current_->id;
+    if (cursor == id) {
+      if (tree_.size() == 1) {
         std::cout << "Warning: cursor set to nobody" << std::endl;
-        current_ = nullptr;
       } else {
-        int newCursor = id == 0 ? 1 : 0;
         std::cout << "(Cursor set to person 0)" << std::endl;
-        current_ = people_[newCursor];
       }
+      cursor = 0;
+    } else if (cursor > id) {
+      cursor--;
     }
-    people_.erase(people_.begin() + id);
-    for (auto person = people_.begin() + id; person != people_.end(); ++person) {
-      (*person)->id--;
-    }
+    tree_.remove(id);
+    current_ = tree_.person(cursor);
     return;
   }
-  std::vector<std::string> relationChain = utils::parseLine(args[0], '.');
-  std::vector<std::shared_ptr<struct Person>> p = utils::computeRelation(relationChain, current_);
+  // the last relation of the chain is unset on the person the whole chain
+  // reaches
+  std::vector<std::shared_ptr<struct Person>> p = relation(args[0]);
   if (!p.size()) {
     std::cerr << "remove: Could not get to that relation" << std::endl;
     return;
@@ -283,7 +426,11 @@ void CLI::remove(commandArgs args) {
     std::cerr << "remove: Can't remove a grouping relation" << std::endl;
     return;
   }
-  if (!utils::rmRelation(relationChain.back(), p[0])) {
+  Status status = tree_.detach(p[0], utils::splitRelation(args[0]).second);
+  follow();
+  if (!status) {
+    if (status.error != "Could not remove relation")
+      std::cerr << status.error << std::endl;
     std::cerr << "remove: Could not remove relation" << std::endl;
   }
 }
@@ -297,16 +444,15 @@ void CLI::overwrite(commandArgs args) {
     std::cerr << "Usage:" << std::endl << "\t overwrite <first name> <last name> <sex> <birth> [<death>]" << std::endl;
     return;
   }
-  std::shared_ptr<struct Person> created = utils::parsePerson(args);
-  if (!created) {
+  std::string error;
+  std::shared_ptr<struct Person> fields = utils::parsePerson(args, error);
+  if (!fields) {
+    std::cerr << error << std::endl;
     std::cerr << "overwrite: Could not modify person" << std::endl;
     return;
   }
-  current_->firstName_ = created->firstName_;
-  current_->lastName_ = created->lastName_;
-  current_->sex_ = created->sex_;
-  current_->born_ = created->born_;
-  current_->dead_ = created->dead_;
+  tree_.overwrite(current_, *fields);
+  follow();
   current_->info();
 }
 
@@ -315,54 +461,276 @@ void CLI::info(commandArgs args) {
     std::cerr << "info: You must create at least one person before. Your cursor is nobody!" << std::endl;
     return;
   }
+  Format format = Format::TEXT;
+  if (!formatOption("info", args, &format))
+    return;
   if (args.size() > 1) {
-    std::cerr << "Usage:" << std::endl << "\t info [<relation> | <id>]" << std::endl;
+    std::cerr << "Usage:" << std::endl << "\t info [--format <format>] [<relation> | <id>]" << std::endl;
     return;
   }
+  std::vector<std::shared_ptr<struct Person>> people;
+  int id = args.empty() ? -1 : utils::parseId(args[0]);
   if (args.empty()) {
-    current_->info();
-    return;
-  }
-  int id = utils::parseId(args[0]);
-  if (id >= 0 && id < people_.size()) {
-    people_[id]->info();
-    return;
+    people = { current_ };
+  } else if (id >= 0 && id < tree_.size()) {
+    people = { tree_.person(id) };
+  } else {
+    people = relation(args[0]);
   }
-  std::vector<std::string> relationChain = utils::parseLine(args[0], '.');
-  std::vector<std::shared_ptr<struct Person>> people = utils::computeRelation(relationChain, current_);
   if (!people.size()) {
     std::cout << "Nobody" << std::endl;
     return;
   }
-  for (auto& person : people) {
-    person->info();
-  }
+  output::render(people, format);
 }
 
 void CLI::list(commandArgs args) {
-  if (people_.empty()) {
+  Format format = Format::TEXT;
+  if (!formatOption("list", args, &format))
+    return;
+  if (!tree_.size()) {
     std::cout << "No person exists yet" << std::endl;
     return;
   }
-  for (auto& person : people_) {
-    person->info();
-  }
+  tree_.loadAll();
+  output::render(tree_.people(), format);
 }
 
 void CLI::search(commandArgs args) {
+  Format format = Format::TEXT;
+  bool contains = false;
+  bool caseless = false;
+  while (args.size() > 1 && args[0].starts_with('-')) {
+    if (args[0] == "--contains") {
+      contains = true;
+      args = args.subspan(1);
+    } else if (args[0] == "-i") {
+      caseless = true;
+      args = args.subspan(1);
+    } else if (args[0] == "--format") {
+      if (!formatOption("search", args, &format))
+        return;
+    } else {
+      break;
+    }
+  }
   if (args.size() != 1) {
-    std::cerr << "Usage:" << std::endl << "\t search <name>" << std::endl;
+    std::cerr << "Usage:" << std::endl << "\t search [--format <format>] [--contains] [-i] <name>" << std::endl;
     return;
   }
-  if (people_.empty()) {
+  if (!tree_.size()) {
     std::cout << "No person exists yet" << std::endl;
     return;
   }
-  for (auto& person : people_) {
-    if (person->firstName_ == args[0] || person->lastName_ == args[0]) {
-      person->info();
+  tree_.loadAll();
+  if (names_.version_ != tree_.version()) {
+    names_.build(tree_.people());
+    names_.version_ = tree_.version();
+  }
+  std::vector<std::shared_ptr<struct Person>> found;
+  for (int id : names_.find(tree_.people(), args[0], contains, caseless)) {
+    found.push_back(tree_.people()[id]);
+  }
+  output::render(found, format);
+}
+
+void CLI::find(commandArgs args) {
+  Format format = Format::TEXT;
+  bool explain = false;
+  while (args.size() && args[0].starts_with("--")) {
+    if (args[0] == "--explain") {
+      explain = true;
+      args = args.subspan(1);
+    } else if (args[0] == "--format") {
+      if (!formatOption("find", args, &format))
+        return;
+    } else {
+      break;
+    }
+  }
+  if (args.empty()) {
+    std::cerr << "Usage:" << std::endl << "\t find [--format <format>] [--explain] <term>... [sort=[-]<field>] [limit=<n>]" << std::endl;
+    return;
+  }
+  Query query;
+  std::string error;
+  if (!query.parse(args, error)) {
+    std::cerr << "find: " << error << std::endl;
+    return;
+  }
+  if (!tree_.size()) {
+    std::cout << "No person exists yet" << std::endl;
+    return;
+  }
+  tree_.loadAll();
+  if (!query.bind(tree_, current_, error)) {
+    std::cerr << "find: " << error << std::endl;
+    return;
+  }
+  if (finder_.version_ != tree_.version()) {
+    finder_.build(tree_.people());
+    finder_.version_ = tree_.version();
+  }
+  bool scan = std::any_of(query.predicates_.begin(), query.predicates_.end(), [](const Predicate& p) { return p.op == Predicate::CONTAINS; });
+  if (scan && names_.version_ != tree_.version()) {
+    names_.build(tree_.people());
+    names_.version_ = tree_.version();
+  }
+  std::string plan;
+  std::vector<std::shared_ptr<struct Person>> found;
+  for (int id : finder_.run(query, tree_.people(), names_, plan)) {
+    found.push_back(tree_.people()[id]);
+  }
+  if (explain)
+    std::cerr << "find: " << plan << std::endl;
+  output::render(found, format);
+}
+
+void CLI::analyze(commandArgs args) {
+  size_t surnames = 10;
+  if (args.size() >= 2 && args[0] == "--surnames") {
+    int n = utils::parseId(args[1]);
+    if (n < 0) {
+      std::cerr << "analyze: " << args[1] << " is not a valid number" << std::endl;
+      return;
+    }
+    surnames = n;
+    args = args.subspan(2);
+  }
+  if (args.size() > 1) {
+    std::cerr << "Usage:" << std::endl << "\t analyze [--surnames <n>] [<id>]" << std::endl;
+    return;
+  }
+  if (!current_) {
+    std::cerr << "analyze: You must create at least one person before. Your cursor is nobody!" << std::endl;
+    return;
+  }
+  std::shared_ptr<struct Person> start = current_;
+  if (args.size()) {
+    int id = utils::parseId(args[0]);
+    if (id < 0 || id >= tree_.size()) {
+      std::cerr << "analyze: " << args[0] << " is not a valid ID" << std::endl;
+      return;
     }
+    start = tree_.person(id);
+  }
+  tree_.loadAll();
+  std::vector<int> ranks(tree_.size(), -1);
+  auto gens = utils::generations(tree_, start);
+  for (int gen = 0; gen < gens.size(); ++gen) {
+    for (auto& person : gens[gen])
+      ranks[person->id] = gen;
   }
+  analysis::print(analysis::analyze(tree_.people(), ranks), surnames);
+}
+
+void CLI::collapse(commandArgs args) {
+  if (args.size() != 1 && args.size() != 2) {
+    std::cerr << "Usage:" << std::endl << "\t collapse <id> [<depth>]" << std::endl;
+    return;
+  }
+  int id = utils::parseId(args[0]);
+  if (id < 0 || id >= tree_.size()) {
+    std::cerr << "collapse: " << args[0] << " is not a valid ID" << std::endl;
+    return;
+  }
+  // a generation adds at least one person, until parents loop
+  size_t depth = tree_.size();
+  if (args.size() == 2) {
+    int d = utils::parseId(args[1]);
+    if (d < 0) {
+      std::cerr << "collapse: " << args[1] << " is not a valid depth" << std::endl;
+      return;
+    }
+    depth = d;
+  }
+  size_t distinct;
+  bool looped;
+  // ancestors through several lines shown by generation
+  auto generations = analysis::collapse(tree_, tree_.person(id), depth, 10, distinct, looped);
+  analysis::print(generations, distinct);
+  if (looped)
+    std::cerr << "collapse: Parents loop among the ancestors, stopped after generation " << generations.size() << std::endl;
+}
+
+void CLI::report(commandArgs args) {
+  if ((args.size() != 2 && args.size() != 3) || (args[0] != "descendants" && args[0] != "ancestors")) {
+    std::cerr << "Usage:" << std::endl << "\t report descendants <id> [<depth>]" << std::endl << "\t report ancestors <id> [<depth>]" << std::endl;
+    return;
+  }
+  int id = utils::parseId(args[1]);
+  if (id < 0 || id >= tree_.size()) {
+    std::cerr << "report: " << args[1] << " is not a valid ID" << std::endl;
+    return;
+  }
+  size_t depth = -1;
+  if (args.size() == 3) {
+    int d = utils::parseId(args[2]);
+    if (d < 0) {
+      std::cerr << "report: " << args[2] << " is not a valid depth" << std::endl;
+      return;
+    }
+    depth = d;
+  }
+  if (args[0] == "descendants")
+    report::descendants(tree_, tree_.person(id), depth);
+  else
+    report::ancestors(tree_, tree_.person(id), depth);
+}
+
+static void appendPerson(std::string& out, const struct Person& p) {
+  out += "ID ";
+  Date::append(out, p.id);
+  out += ' ';
+  out += p.firstName_;
+  out += ' ';
+  out += p.lastName_;
+}
+
+void CLI::relate(commandArgs args) {
+  if (args.size() != 2) {
+    std::cerr << "Usage:" << std::endl << "\t relate <id1> <id2>" << std::endl;
+    return;
+  }
+  int ids[2];
+  for (int i = 0; i < 2; i++) {
+    ids[i] = utils::parseId(args[i]);
+    if (ids[i] < 0 || ids[i] >= tree_.size()) {
+      std::cerr << "relate: " << args[i] << " is not a valid ID" << std::endl;
+      return;
+    }
+  }
+  std::shared_ptr<struct Person> a = tree_.person(ids[0]);
+  std::shared_ptr<struct Person> b = tree_.person(ids[1]);
+  if (a == b) {
+    std::cout << "ID " << a->id << " is the same person" << std::endl;
+    return;
+  }
+  kinship::Kinship k = kinship::relate(tree_, a.get(), b.get());
+  if (k.path.empty()) {
+    std::cout << "ID " << a->id << " and ID " << b->id << " are not related" << std::endl;
+    return;
+  }
+  bool exact;
+  std::string out = "Path: ";
+  out += kinship::chain(tree_, k.path, &exact);
+  if (!exact)
+    out += " (a child of the same name comes first on the way)";
+  out += '\n';
+  std::string name = kinship::name(k, b->sex_);
+  appendPerson(out, *b);
+  out += name.empty() ? " is related by marriage to " : " is the " + name + " of ";
+  appendPerson(out, *a);
+  out += '\n';
+  if (k.up > 0 && k.down > 0) {
+    out += "Nearest common ancestors:";
+    for (size_t i = 0; i < k.ancestors.size(); i++) {
+      out += i ? ", " : " ";
+      appendPerson(out, *k.ancestors[i]);
+    }
+    out += '\n';
+  }
+  std::cout << out;
 }
 
 void CLI::select(commandArgs args) {
@@ -376,16 +744,15 @@ void CLI::select(commandArgs args) {
   }
   int id = utils::parseId(args[0]);
   if (id != -1) {
-    if (id < 0 || id >= people_.size()) {
+    if (id < 0 || id >= tree_.size()) {
       std::cerr << "select: ID does not exist" << std::endl;
       return;
     }
-    current_ = people_[id];
+    current_ = tree_.person(id);
     current_->info();
     return;
   }
-  std::vector<std::string> relationChain = utils::parseLine(args[0], '.');
-  std::vector<std::shared_ptr<struct Person>> p = utils::computeRelation(relationChain, current_);
+  std::vector<std::shared_ptr<struct Person>> p = relation(args[0]);
   if (!p.size()) {
     std::cerr << "select: Could not get to that relation" << std::endl;
     return;
@@ -399,135 +766,487 @@ void CLI::select(commandArgs args) {
 }
 
 void CLI::dump(commandArgs args) {
-  if (!people_.size()) {
+  Job job;
+  if (Task task = dumpTask(args))
+    task(job);
+}
+
+Task CLI::dumpTask(commandArgs args) {
+  if (!tree_.size()) {
     std::cerr << "Nobody exists" << std::endl;
-    return;
+    return nullptr;
+  }
+  bool compact = false;
+  Branch branch;
+  while (args.size() && args[0].starts_with("--")) {
+    size_t left = args.size();
+    if (args[0] == "--archive") {
+      compact = true;
+      args = args.subspan(1);
+    } else if (!branchOptions("dump", args, &branch)) {
+      return nullptr;
+    }
+    if (args.size() == left)
+      break;
+  }
+  if (args.size() != 1) {
+    std::cerr << "Usage:" << std::endl << "\t dump [--archive] <file>" << std::endl << "\t dump [--archive] --from <relation|id> [--ancestors <n>] [--descendants <n>] [--with-spouses] <file>" << std::endl;
+    return nullptr;
   }
+  std::string file(args[0]);
+  // the tree as it is now, modifications copy it away from the task. A
+  // branch is copied alone, so that a lazy tree only reads it
+  auto tree = std::make_shared<Tree>(branch.from == -1 ? tree_.fork() : tree_.extract(branch));
+  return [tree, file, compact, branch](Job& job) {
+    Status status = tree->dump(file, compact, { &job.cancelled, &job.done, &job.total });
+    if (!status) {
+      job.err() << "dump: " << status.error << std::endl;
+      return false;
+    }
+    job.out() << (branch.from != -1 ? "Branch " : "Tree ") << (compact ? "archived to " : "dumped to ") << file << std::endl;
+    return true;
+  };
+}
+
+void CLI::load(commandArgs args) {
   if (args.size() != 1) {
-    std::cerr << "Usage:" << std::endl << "\t dump <file>" << std::endl;
+    std::cerr << "Usage:" << std::endl << "\t load <file>" << std::endl;
+    return;
+  }
+  Result<size_t> loaded = tree_.load(std::string(args[0]));
+  if (!loaded) {
+    std::cerr << "load: " << loaded.error << std::endl;
     return;
   }
-  std::ofstream out(args[0]);
-  if (!out.good()) {
-    std::cerr << "dump: Could not write to file " << args[0] << std::endl;
+  std::cout << "Loaded " << loaded.value << " people" << std::endl;
+  if (!current_) {
+    current_ = tree_.person(0);
+    std::cout << "(Cursor set to ID 0)" << std::endl;
+  }
+}
+
+void CLI::hash(commandArgs args) {
+  if (args.size() > 1) {
+    std::cerr << "Usage:" << std::endl << "\t hash" << std::endl << "\t hash <id>" << std::endl;
     return;
   }
-  out << people_.size() << std::endl;
-  int i = 0;
-  for (auto& person : people_) {
-    person->id = i;
-    i++;
-    out << person->dump() << std::endl;
+  if (!tree_.size()) {
+    std::cerr << "Nobody exists" << std::endl;
+    return;
   }
-  for (auto& person : people_) {
-    out << (person->father_ ? person->father_->id : -1) << ' ' << (person->mother_ ? person->mother_->id : -1) << std::endl;
+  int id = -1;
+  if (args.size()) {
+    id = utils::parseId(args[0]);
+    if (id < 0 || id >= tree_.size()) {
+      std::cerr << "hash: ID does not exist" << std::endl;
+      return;
+    }
+  }
+  merkle::Hashes hashes = tree_.hashes();
+  std::cout << "Tree: " << merkle::format(hashes.tree) << std::endl;
+  if (id != -1) {
+    std::cout << "Person: " << merkle::format(hashes.person[id]) << std::endl;
+    std::cout << "Branch: " << merkle::format(hashes.branch[id]) << std::endl;
   }
-  out.close();
-  std::cout << "Tree dumped to " << args[0] << std::endl;
 }
 
-void CLI::load(commandArgs args) {
-  if (args.size() != 1) {
-    std::cerr << "Usage:" << std::endl << "\t load <file>" << std::endl;
+void CLI::diff(commandArgs args) {
+  if (args.size() != 2 && args.size() != 3) {
+    std::cerr << "Usage:" << std::endl << "\t diff <file a> <file b>" << std::endl << "\t diff <file a> <file b> <patch>" << std::endl;
     return;
   }
-  std::ifstream in(args[0]);
-  if (!in.good()) {
-    std::cerr << "load: Could not open " << args[0] << std::endl;
+  Tree trees[2];
+  Result<size_t> opened[2];
+  utils::parallelFor(2, [&](size_t i) {
+    opened[i] = trees[i].open(std::string(args[i]));
+  });
+  for (int i = 0; i < 2; i++) {
+    if (!opened[i]) {
+      std::cerr << "diff: " << opened[i].error << std::endl;
+      return;
+    }
+  }
+  const std::vector<std::shared_ptr<struct Person>>& a = trees[0].people();
+  const std::vector<std::shared_ptr<struct Person>>& b = trees[1].people();
+  merkle::Patch patch = merkle::diff(a, trees[0].hashes(), b, trees[1].hashes());
+  if (patch.empty()) {
+    std::cout << "Trees are identical" << std::endl;
+  } else {
+    // people of a by their IDs in a, people of b by their IDs in b
+    std::string out;
+    for (int id : patch.removed) {
+      out += "- ";
+      appendPerson(out, *a[id]);
+      out += '\n';
+    }
+    for (auto& [id, p] : patch.changed) {
+      out += "~ ";
+      appendPerson(out, *a[id]);
+      out += " -> ";
+      appendPerson(out, *p);
+      out += '\n';
+    }
+    for (auto& p : patch.added) {
+      out += "+ ";
+      appendPerson(out, *p);
+      out += '\n';
+    }
+    size_t relinked = 0;
+    for (auto& link : patch.links) {
+      if ((size_t)link.id >= patch.size)
+        continue;
+      out += "= ";
+      appendPerson(out, *a[link.id]);
+      out += " has other parents\n";
+      relinked++;
+    }
+    std::cout << out;
+    std::cout << patch.added.size() << " added, " << patch.removed.size() << " removed, " << patch.changed.size() << " changed, " << relinked << " given other parents";
+    std::cout << " (" << patch.skipped << " identical branches skipped)" << std::endl;
+  }
+  if (args.size() == 3) {
+    Status status = merkle::write(std::string(args[2]), patch);
+    if (!status) {
+      std::cerr << "diff: " << status.error << std::endl;
+      return;
+    }
+    std::cout << "Patch written to " << args[2] << std::endl;
+  }
+}
+
+void CLI::patch(commandArgs args) {
+  if (args.size() != 1) {
+    std::cerr << "Usage:" << std::endl << "\t patch <patch>" << std::endl;
     return;
   }
-  std::vector<std::shared_ptr<struct Person>> people = utils::parseFile(in);
-  if (!people.size()) {
-    std::cerr << "load: Could not load file" << std::endl;
+  Result<merkle::Patch> read = merkle::read(std::string(args[0]));
+  if (!read) {
+    std::cerr << "patch: " << read.error << std::endl;
     return;
   }
-  int i = 0;
-  for (auto& person : people) {
-    person->id = i + people_.size();
-    people_.push_back(person);
+  // the id of the cursor once the people removed are gone, -1 for one of them
+  int cursor = current_ ? current_->id : -1;
+  for (int id : read.value.removed) {
+    if (cursor == id)
+      cursor = -1;
   }
+  if (cursor != -1)
+    cursor -= std::count_if(read.value.removed.begin(), read.value.removed.end(), [cursor](int id) { return id < cursor; });
+  Status status = tree_.patch(read.value);
+  if (!status) {
+    std::cerr << "patch: " << status.error << std::endl;
+    return;
+  }
+  current_ = tree_.person(cursor);
+  if (!status.warning.empty())
+    std::cout << status.warning << std::endl;
+  std::cout << "Patched: " << read.value.added.size() << " added, " << read.value.removed.size() << " removed, " << read.value.changed.size() << " changed" << std::endl;
   if (!current_) {
-    current_ = people_[0];
-    std::cout << "(Cursor set to ID 0)" << std::endl;
+    current_ = tree_.person(0);
+    if (current_)
+      std::cout << "(Cursor set to ID 0)" << std::endl;
   }
 }
 
+void CLI::fsck(commandArgs args) {
+  bool repair = args.size() == 1 && args[0] == "--repair";
+  if (args.size() && !repair) {
+    std::cerr << "Usage:" << std::endl << "\t fsck" << std::endl << "\t fsck --repair" << std::endl;
+    return;
+  }
+  std::vector<integrity::Issue> issues = tree_.check(repair);
+  follow();
+  const std::vector<std::shared_ptr<struct Person>>& people = tree_.people();
+  // the parent or child concerned
+  auto other = [&people](std::string& out, const integrity::Issue& issue) {
+    if (issue.other == -1)
+      out += "a person outside the tree";
+    else
+      appendPerson(out, *people[issue.other]);
+  };
+  std::string out;
+  size_t repaired = 0;
+  for (auto& issue : issues) {
+    std::string_view parent = issue.father ? "father " : "mother ";
+    appendPerson(out, *people[issue.id]);
+    out += ": ";
+    switch (issue.kind) {
+    case integrity::SEX:
+      out += parent;
+      other(out, issue);
+      out += issue.father ? " is not a man" : " is not a woman";
+      break;
+    case integrity::CYCLE:
+      out += parent;
+      other(out, issue);
+      out += " is also their descendant";
+      break;
+    case integrity::BIRTH:
+      out += "born before their ";
+      out += parent;
+      other(out, issue);
+      break;
+    case integrity::DEATH:
+      out += "died before being born";
+      break;
+    case integrity::UNLISTED:
+      out += "missing from the children of their ";
+      out += parent;
+      other(out, issue);
+      break;
+    case integrity::STRAY:
+      other(out, issue);
+      out += " is among their children without having them as parent";
+      break;
+    case integrity::DUPLICATE:
+      other(out, issue);
+      out += " is among their children more than once";
+      break;
+    case integrity::FOREIGN:
+      out += parent;
+      out += "is not in the tree";
+      break;
+    }
+    if (issue.repaired) {
+      out += " (repaired)";
+      repaired++;
+    }
+    out += '\n';
+  }
+  output::write(out);
+  if (issues.empty())
+    std::cout << "No problem found" << std::endl;
+  else
+    std::cout << issues.size() << " problems found, " << repaired << " repaired" << std::endl;
+}
+
 void CLI::generateImage(commandArgs args) {
+  Job job;
+  if (Task task = generateImageTask(args))
+    task(job);
+}
+
+Task CLI::generateImageTask(commandArgs args) {
   if (!current_) {
     std::cerr << "generate-image: You must create at least one person before. Your cursor is nobody!" << std::endl;
-    return;
+    return nullptr;
+  }
+  dot::Options options;
+  size_t tileSize = 0;
+  Branch branch;
+  while (args.size() && args[0].starts_with("--")) {
+    size_t left = args.size();
+    if (!branchOptions("generate-image", args, &branch)) {
+      return nullptr;
+    } else if (args.size() != left) {
+      continue;
+    } else if (args[0] == "--tiled") {
+      tileSize = tileSize ? tileSize : 1000;
+      args = args.subspan(1);
+    } else if (args[0] == "--tile-size" && args.size() > 1) {
+      int n = utils::parseId(args[1]);
+      if (n <= 0) {
+        std::cerr << "generate-image: " << args[1] << " is not a valid tile size" << std::endl;
+        return nullptr;
+      }
+      tileSize = n;
+      args = args.subspan(2);
+    } else if (args[0] == "--remincross") {
+      options.remincross = true;
+      args = args.subspan(1);
+    } else if (args[0] == "--mclimit" && args.size() > 1) {
+      std::string value(args[1]);
+      char* end = nullptr;
+      options.mclimit = std::strtod(value.c_str(), &end);
+      if (value.empty() || *end || !(options.mclimit > 0)) {
+        std::cerr << "generate-image: " << args[1] << " is not a valid mclimit" << std::endl;
+        return nullptr;
+      }
+      args = args.subspan(2);
+    } else {
+      break;
+    }
   }
   if (args.size() != 1) {
-    std::cerr << "Usage:" << std::endl << "\t generate-image <file>" << std::endl;
-    return;
-  }
-  std::string dotFile = args[0] + ".dot";
-  std::ofstream out(dotFile);
-  if (!out.good()) {
-    std::cerr << "generate-image: Could not write DOT file " << dotFile << std::endl;
-    return;
-  }
-  auto gens = utils::generations(current_, people_.size());
-  int iGen = 0;
-  assert(gens.size() > 0);
-  // from oldest to get a proper order
-  gens = utils::generations(gens[0][0], people_.size());
-
-  out << "graph G {" << std::endl;
-  out << "graph [newrank=true, ranksep=3, concentrate=true, overlap=false, splines=true]" << std::endl;
-  out << "edge [dir=none]" << std::endl;
-  while (iGen < gens.size()) {
-    out << "subgraph gen" << iGen << " {" << std::endl << "rank = same" << std::endl;
-    std::set<int> ids = {};
-    std::string prevId = "";
-    for (auto& person : gens[iGen]) {
-      std::set<std::shared_ptr<struct Person>> spouses = {};
-      if (!ids.contains(person->id)) {
-        out << person->dot() << std::endl;
-        ids.insert(person->id);
-        for (auto& child : person->children_) {
-          if (child->father_ && child->mother_) {
-            if (child->father_ == person && !spouses.contains(child->mother_)) {
-              spouses.insert(child->mother_);
-            } else if (child->mother_ == person && !spouses.contains(child->father_)) {
-              spouses.insert(child->father_);
-            }
-          }
-        }
-        if (prevId != "") {
-          out << prevId << "--" << person->dotId() << " [style=invis]" << std::endl;
-        }
-        prevId = utils::dotCompleteSpouses(out, ids, person);
+    std::cerr << "Usage:" << std::endl << "\t generate-image [--tiled] [--tile-size <n>] [--mclimit <factor>] [--remincross] [--from <relation|id> [--ancestors <n>] [--descendants <n>] [--with-spouses]] <file>" << std::endl;
+    return nullptr;
+  }
+  // the tree as it is now, modifications copy it away from the task. A
+  // branch is copied alone, so that a lazy tree only reads it
+  std::vector<int> generations;
+  auto tree = std::make_shared<Tree>(branch.from == -1 ? tree_.fork() : tree_.extract(branch, &generations));
+  return [tree, current = current_, file = std::string(args[0]), tileSize, options, generations](Job& job) mutable {
+    options.cancel = &job.cancelled;
+    std::vector<std::vector<std::shared_ptr<struct Person>>> gens;
+    if (!generations.empty()) {
+      // the generations of the branch only, oldest first
+      int oldest = *std::min_element(generations.begin(), generations.end());
+      for (size_t id = 0; id < generations.size(); ++id) {
+        if (gens.size() <= (size_t)(generations[id] - oldest))
+          gens.resize(generations[id] - oldest + 1);
+        gens[generations[id] - oldest].push_back(tree->person(id));
       }
+    } else {
+      gens = utils::generations(*tree, current);
+      assert(gens.size() > 0);
+      // from oldest to get a proper order
+      gens = utils::generations(*tree, gens[0][0]);
     }
-    out << '}' << std::endl;
+    if (tileSize) {
+      options.progress = [&job](size_t done, size_t total) {
+        job.done = done;
+        job.total = total;
+      };
+      dot::Tiles tiles = dot::renderTiles(tree->people(), gens, file, tileSize, options);
+      if (job.cancelled) {
+        job.err() << "generate-image: cancelled" << std::endl;
+        return false;
+      }
+      if (tiles.status == 127) {
+        job.err() << "generate-image: Graphviz is not installed. Generated DOT files of " << tiles.count << " tiles next to " << file << std::endl;
+      } else if (tiles.status) {
+        job.err() << "generate-image: error in image generation from graphviz (code " << tiles.status << ")" << std::endl;
+        return false;
+      }
+      job.out() << "Generated index of " << tiles.count << " tiles at " << tiles.index << std::endl;
+      return true;
+    }
+    dot::Layout layout(tree->people(), gens);
+    layout.order(options.passes);
 
-    for (auto& person : gens[iGen]) {
-      if (person->father_ && person->mother_) {
-        out << utils::uniqueDualId(person->father_, person->mother_)  + ":s" << "--" << person->dotId() + ":n" << std::endl;
-      } else if (person->father_) {
-        out << person->father_->dotId() + ":s" << "--" << person->dotId() + ":n" << std::endl;
-      } else if (person->mother_) {
-        out << person->mother_->dotId() + ":s" << "--" << person->dotId() + ":n" << std::endl;
+    job.total = 1;
+    int status = dot::render(layout, "png", file, options);
+    if (job.cancelled) {
+      job.err() << "generate-image: cancelled" << std::endl;
+      std::remove(file.c_str());
+      return false;
+    }
+    if (status == 127) {
+      std::string dotFile = file + ".dot";
+      FILE* out = fopen(dotFile.c_str(), "w");
+      if (!out) {
+        job.err() << "generate-image: Could not write DOT file " << dotFile << std::endl;
+        return false;
       }
+      layout.write(out, options);
+      fclose(out);
+      job.err() << "generate-image: Graphviz is not installed. Generated DOT file at " << dotFile << std::endl;
+      return true;
+    }
+    if (status) {
+      job.err() << "generate-image: error in image generation from graphviz (code " << status << ")" << std::endl;
+      std::remove(file.c_str());
+      return false;
     }
-    iGen++;
+    job.done = 1;
+    job.out() << "Generated PNG file at " << file << std::endl;
+    return true;
+  };
+}
+
+void CLI::jobs(commandArgs args) {
+  if (args.size()) {
+    std::cerr << "Usage:" << std::endl << "\t jobs" << std::endl;
+    return;
+  }
+  jobs_.list();
+}
+
+void CLI::job(commandArgs args) {
+  if (args.size() >= 2 && args[0] == "run") {
+    static constexpr std::pair<std::string_view, TaskCommand> tasks[] = {
+      { "generate-image", &CLI::generateImageTask },
+      { "dump", &CLI::dumpTask }
+    };
+    auto found = std::find_if(std::begin(tasks), std::end(tasks), [&](auto& t) { return t.first == args[1]; });
+    if (found == std::end(tasks)) {
+      std::cerr << "job: " << args[1] << " cannot run in the background" << std::endl;
+      return;
+    }
+    std::string command;
+    for (auto arg : args.subspan(1))
+      command += (command.empty() ? "" : " ") + std::string(arg);
+    if (Task task = (this->*found->second)(args.subspan(2)))
+      jobs_.start(command, std::move(task));
+    return;
+  }
+  if (args.size() == 1 && args[0] == "wait") {
+    jobs_.waitAll();
+    return;
   }
-  out << "}" << std::endl;
-  out.close();
+  if (args.size() == 2 && (args[0] == "wait" || args[0] == "cancel")) {
+    int n = utils::parseId(args[1]);
+    if (!(args[0] == "wait" ? jobs_.wait(n) : jobs_.cancel(n)))
+      std::cerr << "job: No job " << args[1] << std::endl;
+    return;
+  }
+  std::cerr << "Usage:" << std::endl << "\t job run <command>" << std::endl << "\t job wait [<n>]" << std::endl << "\t job cancel <n>" << std::endl;
+}
 
-  int status = system(("2> /dev/null dot -Tpng " + dotFile + " 1> " + args[0]).c_str());
-  if (status == 127) {
-    std::cerr << "generate-image: Graphviz is not installed. Generated DOT file at " << dotFile << std::endl;
+void CLI::workspace(commandArgs args) {
+  if (args.empty()) {
+    std::set<std::string_view> names = { workspace_ };
+    for (auto& [name, ws] : workspaces_)
+      names.insert(name);
+    for (auto& name : names) {
+      size_t n = name == workspace_ ? tree_.size() : workspaces_.find(name)->second.tree.size();
+      std::cout << (name == workspace_ ? "* " : "  ") << name << " (" << n << " people)" << std::endl;
+    }
+    return;
+  }
+  if (args.size() != 2 || (args[0] != "new" && args[0] != "fork" && args[0] != "switch" && args[0] != "drop")) {
+    std::cerr << "Usage:" << std::endl << "\t workspace" << std::endl << "\t workspace new <name>" << std::endl
+              << "\t workspace fork <name>" << std::endl << "\t workspace switch <name>" << std::endl << "\t workspace drop <name>" << std::endl;
+    return;
+  }
+  std::string name(args[1]);
+  bool exists = name == workspace_ || workspaces_.contains(name);
+  if ((args[0] == "new" || args[0] == "fork") && exists) {
+    std::cerr << "workspace: " << name << " already exists" << std::endl;
+    return;
+  }
+  if ((args[0] == "switch" || args[0] == "drop") && !exists) {
+    std::cerr << "workspace: " << name << " does not exist" << std::endl;
     return;
   }
-  //std::remove(dotFile.c_str());
-  if (status) {
-    std::cerr << "generate-image: error in image generation from graphviz (code " << status << ")" << std::endl;
-    std::remove(args[0].c_str());
+
+  if (args[0] == "new") {
+    workspaces_[name] = Workspace();
+    switchTo(name);
+  } else if (args[0] == "fork") {
+    // both workspaces point to the same people until one is modified
+    workspaces_[name] = { tree_.fork(), current_ };
+    switchTo(name);
+  } else if (args[0] == "switch") {
+    if (name != workspace_)
+      switchTo(name);
+  } else {
+    if (name == workspace_) {
+      std::cerr << "workspace: Can't drop the current workspace" << std::endl;
+      return;
+    }
+    auto it = workspaces_.find(name);
+    it->second.tree.close();
+    workspaces_.erase(it);
+    std::cout << "Dropped workspace " << name << std::endl;
+  }
+}
+
+void CLI::mem(commandArgs args) {
+  if (args.size()) {
+    std::cerr << "Usage:" << std::endl << "\t mem" << std::endl;
     return;
   }
-  std::cout << "Generated PNG file at " << args[0] << std::endl;
+  // forks share their table
+  std::set<const std::vector<std::shared_ptr<struct Person>>*> tables = { tree_.table() };
+  for (auto& [name, ws] : workspaces_)
+    tables.insert(ws.tree.table());
+  long bytes = 0;
+  for (auto table : tables)
+    bytes += table->capacity() * sizeof(std::shared_ptr<struct Person>);
+  memory::print(bytes, tables.size());
+  const RelationMemo& memo = tree_.memo();
+  std::cout << "Relation memo: " << memo.size() << " chains, " << memo.hits_ << " hits, " << memo.misses_ << " misses" << std::endl;
 }
 /* commands */
 
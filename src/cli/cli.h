@@ -1,14 +1,20 @@
 #pragma once
 
-#include "person.h"
+#include "tree.h"
+#include "utils.h"
+#include "output.h"
+#include "scan.h"
+#include "query.h"
+#include "jobs.h"
 #include <vector>
 #include <string>
+#include <string_view>
+#include <span>
 #include <memory>
-#include <map>
-#include <functional>
 #include <cstdio>
 #include <fstream>
 #include <set>
+#include <map>
 
 #ifndef PS1
   #define PS1 "genea>> "
@@ -18,39 +24,52 @@
 
 namespace genea {
 
-namespace utils {
-
-std::vector<std::shared_ptr<struct Person>> computeRelation(std::vector<std::string> relations, std::shared_ptr<struct Person> start);
-bool setRelation(const std::string& relation, std::shared_ptr<struct Person> p, std::shared_ptr<struct Person> other);
-bool rmRelation(const std::string& relation, std::shared_ptr<struct Person> p);
-std::shared_ptr<struct Person> parsePerson(std::vector<std::string> args);
-bool parseDate(const std::string& s, struct Date* d);
-std::vector<std::string> parseLine(const std::string& line, char sep);
-int parseId(const std::string& arg);
-std::vector<std::shared_ptr<struct Person>> parseFile(std::ifstream& in);
-std::vector<std::vector<std::shared_ptr<struct Person>>> generations(std::shared_ptr<struct Person> start, int maxPeople);
-std::string uniqueDualId(std::shared_ptr<struct Person> a, std::shared_ptr<struct Person> b);
-std::string dotCompleteSpouses(std::ofstream& out, std::set<int>& ids, std::shared_ptr<struct Person> p);
-
-} // namespace utils
-
-
 class CLI {
 
 public:
-  CLI(const std::string& file);
+  CLI(const std::string& file, bool lazy = false);
   void run();
 
 private:
 
   static std::string banner;
   
-  std::vector<std::shared_ptr<struct Person>> people_;
-  std::map<std::string, std::function<void(std::vector<std::string>)>> commands_;
+  // shares its people with forked workspaces until one of them modifies them
+  Tree tree_;
   std::shared_ptr<struct Person> current_;
 
+  struct Workspace {
+    Tree tree;
+    std::shared_ptr<struct Person> current;
+  };
+  // every workspace but the current one
+  std::map<std::string, Workspace, std::less<>> workspaces_;
+  std::string workspace_ = "main";
+
+  // built for the version of the tree they hold
+  NameIndex names_;
+  FindIndex finder_;
+
+  // last, so that jobs end before anything else goes
+  Jobs jobs_;
+
+  std::vector<std::shared_ptr<struct Person>> relation(std::string_view relations);
+  void follow();
+  void switchTo(const std::string& name);
+
+
+  typedef std::span<const std::string_view> commandArgs;
+  typedef void (CLI::*Command)(commandArgs);
+  static const Command* command(std::string_view name);
+  static bool formatOption(const std::string& command, commandArgs& args, Format* format);
+  bool branchOptions(const std::string& command, commandArgs& args, Branch* branch);
+
+  // commands that can run as jobs check their arguments and take what they
+  // need from the tree, the task does the rest
+  typedef Task (CLI::*TaskCommand)(commandArgs);
+  Task generateImageTask(commandArgs args);
+  Task dumpTask(commandArgs args);
 
-  typedef std::vector<std::string> commandArgs;
   /* commands */
   void help(commandArgs args);
   void create(commandArgs args);
@@ -61,10 +80,23 @@ private:
   void info(commandArgs args);
   void list(commandArgs args);
   void search(commandArgs args);
+  void find(commandArgs args);
+  void analyze(commandArgs args);
+  void collapse(commandArgs args);
+  void report(commandArgs args);
+  void relate(commandArgs args);
   void select(commandArgs args);
   void dump(commandArgs args);
   void load(commandArgs args);
+  void hash(commandArgs args);
+  void diff(commandArgs args);
+  void patch(commandArgs args);
+  void fsck(commandArgs args);
   void generateImage(commandArgs args);
+  void workspace(commandArgs args);
+  void mem(commandArgs args);
+  void jobs(commandArgs args);
+  void job(commandArgs args);
   /* commands */
 };
 
@@ -0,0 +1,118 @@
+#include "input.h"
+#include "cli.h"
+
+#include <iostream>
+#include <cstring>
+#include <cerrno>
+#include <unistd.h>
+
+namespace genea {
+
+// batches ready ahead of the one being executed
+static const size_t readAhead = 2;
+
+
+Input::Input(int fd):
+fd_(fd),
+tty_(isatty(fd)),
+done_(false),
+pos_(0) {
+  if (!tty_)
+    thread_ = std::thread(&Input::reader, this);
+}
+
+Input::~Input() {
+  if (thread_.joinable())
+    thread_.join();
+}
+
+std::string Input::block() {
+  std::unique_lock<std::mutex> lock(mutex_);
+  if (free_.empty())
+    return std::string(INPUT_BLOCK, '\0');
+  std::string res = std::move(free_.back());
+  free_.pop_back();
+  return res;
+}
+
+void Input::reader() {
+  std::string buffer = block();
+  size_t len = 0;
+  bool eof = false;
+  while (!eof) {
+    ssize_t r = read(fd_, &buffer[len], buffer.size() - len);
+    if (r < 0 && errno == EINTR)
+      continue;
+    eof = r <= 0;
+    if (!eof)
+      len += r;
+
+    // lines are split in place, tokens point into the block
+    Batch batch;
+    size_t start = 0;
+    while (start < len) {
+      const char* eol = (const char*)memchr(&buffer[start], '\n', len - start);
+      if (!eol && !eof)
+        break;
+      size_t end = eol ? eol - buffer.data() : len;
+      utils::parseLine(std::string_view(buffer).substr(start, end - start), ' ', batch.tokens);
+      if (batch.tokens.size() != (batch.ends.size() ? batch.ends.back() : 0))
+        batch.ends.push_back(batch.tokens.size());
+      start = end + 1;
+    }
+    start = std::min(start, len);
+
+    // the incomplete last line moves to the next block
+    if (batch.ends.empty()) {
+      memmove(&buffer[0], &buffer[start], len - start);
+      len -= start;
+      if (len == buffer.size())
+        buffer.resize(buffer.size() * 2);
+      continue;
+    }
+    std::string next = block();
+    if (next.size() < 2 * (len - start))
+      next.resize(2 * (len - start));
+    memcpy(&next[0], &buffer[start], len - start);
+    len -= start;
+    batch.text = std::move(buffer);
+    buffer = std::move(next);
+
+    std::unique_lock<std::mutex> lock(mutex_);
+    cond_.wait(lock, [this]() { return ready_.size() < readAhead; });
+    ready_.push_back(std::move(batch));
+    cond_.notify_all();
+  }
+  std::unique_lock<std::mutex> lock(mutex_);
+  done_ = true;
+  cond_.notify_all();
+}
+
+bool Input::next(std::span<const std::string_view>& command) {
+  if (tty_) {
+    if (!std::getline(std::cin, line_))
+      return false;
+    current_.tokens.clear();
+    utils::parseLine(line_, ' ', current_.tokens);
+    command = current_.tokens;
+    return true;
+  }
+  while (pos_ == current_.ends.size()) {
+    std::unique_lock<std::mutex> lock(mutex_);
+    cond_.wait(lock, [this]() { return ready_.size() || done_; });
+    if (ready_.empty())
+      return false;
+    if (current_.text.size() && free_.size() <= readAhead)
+      free_.push_back(std::move(current_.text));
+    current_ = std::move(ready_.front());
+    ready_.pop_front();
+    pos_ = 0;
+    cond_.notify_all();
+  }
+  size_t begin = pos_ ? current_.ends[pos_ - 1] : 0;
+  command = std::span<const std::string_view>(current_.tokens).subspan(begin, current_.ends[pos_] - begin);
+  pos_++;
+  return true;
+}
+
+} // namespace genea
@@ -0,0 +1,63 @@
+#pragma once
+
+#include <vector>
+#include <string>
+#include <string_view>
+#include <span>
+#include <deque>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+
+#ifndef INPUT_BLOCK
+  #define INPUT_BLOCK (1 << 20)
+#endif
+
+namespace genea {
+
+/*
+ * Command source of the CLI
+ * A terminal is read line by line. Piped input is read by large blocks on a
+ * separate thread, which splits and tokenizes the next batch of commands while
+ * the current one is executed. Tokens are views into the block they were read
+ * in, blocks are recycled once their commands are done
+ */
+class Input {
+
+public:
+  Input(int fd);
+  ~Input();
+
+  bool interactive() const {
+    return tty_;
+  }
+
+  // false at the end of the input, the command is valid until the next call
+  bool next(std::span<const std::string_view>& command);
+
+private:
+  struct Batch {
+    std::string text;
+    std::vector<std::string_view> tokens;
+    std::vector<size_t> ends;
+  };
+
+  void reader();
+  std::string block();
+
+  int fd_;
+  bool tty_;
+
+  std::thread thread_;
+  std::mutex mutex_;
+  std::condition_variable cond_;
+  std::deque<Batch> ready_;
+  std::vector<std::string> free_;
+  bool done_;
+
+  Batch current_;
+  size_t pos_;
+  std::string line_;
+};
+
+} // namespace genea
@@ -0,0 +1,96 @@
+#include "jobs.h"
+
+namespace genea {
+
+static const char* stateName(Job::State state) {
+  switch (state) {
+  case Job::RUNNING:
+    return "Running";
+  case Job::DONE:
+    return "Done";
+  case Job::FAILED:
+    return "Failed";
+  default:
+    return "Cancelled";
+  }
+}
+
+Jobs::~Jobs() {
+  for (auto& [n, entry] : jobs_) {
+    entry->job.cancelled = true;
+    entry->thread.join();
+  }
+}
+
+int Jobs::start(std::string command, Task task) {
+  int n = next_++;
+  auto entry = std::make_unique<Entry>();
+  Job& job = entry->job;
+  job.command = std::move(command);
+  job.background = true;
+  entry->thread = std::thread([&job, task = std::move(task)]() mutable {
+    bool ok = task(job);
+    // the tree the task took goes before the job is seen as ended
+    task = nullptr;
+    job.state = job.cancelled ? Job::CANCELLED : ok ? Job::DONE : Job::FAILED;
+  });
+  std::cout << '[' << n << "] " << job.command << std::endl;
+  jobs_.emplace(n, std::move(entry));
+  return n;
+}
+
+void Jobs::list() {
+  for (auto& [n, entry] : jobs_) {
+    Job& job = entry->job;
+    Job::State state = job.state;
+    std::cout << '[' << n << "] " << stateName(state) << ' ' << job.command;
+    size_t total = job.total;
+    if (state == Job::RUNNING && total)
+      std::cout << " (" << job.done << '/' << total << ')';
+    std::cout << std::endl;
+  }
+}
+
+void Jobs::report(int n, Entry& entry) {
+  entry.thread.join();
+  Job& job = entry.job;
+  std::cout << job.log.str();
+  std::cerr << job.errors.str();
+  std::cout << '[' << n << "] " << stateName(job.state) << ' ' << job.command << std::endl;
+}
+
+void Jobs::report() {
+  for (auto it = jobs_.begin(); it != jobs_.end();) {
+    if (it->second->job.state == Job::RUNNING) {
+      ++it;
+      continue;
+    }
+    report(it->first, *it->second);
+    it = jobs_.erase(it);
+  }
+}
+
+bool Jobs::wait(int n) {
+  auto found = jobs_.find(n);
+  if (found == jobs_.end())
+    return false;
+  report(n, *found->second);
+  jobs_.erase(found);
+  return true;
+}
+
+void Jobs::waitAll() {
+  for (auto& [n, entry] : jobs_)
+    report(n, *entry);
+  jobs_.clear();
+}
+
+bool Jobs::cancel(int n) {
+  auto found = jobs_.find(n);
+  if (found == jobs_.end())
+    return false;
+  found->second->job.cancelled = true;
+  return true;
+}
+
+} // namespace genea
@@ -0,0 +1,77 @@
+#pragma once
+
+#include <string>
+#include <sstream>
+#include <iostream>
+#include <functional>
+#include <atomic>
+#include <thread>
+#include <map>
+#include <memory>
+
+namespace genea {
+
+/*
+ * Background jobs
+ * A job runs a long command on its own thread while the shell goes on. The
+ * command takes what it needs from the tree before it starts: the people are
+ * shared as with a forked workspace, so later changes copy them and the job
+ * keeps working on the tree as it was
+ * Messages of a job are kept until it is reported, at the next command or by
+ * job wait
+ */
+struct Job {
+  enum State { RUNNING, DONE, FAILED, CANCELLED };
+
+  std::string command;
+  std::atomic<State> state = RUNNING;
+  std::atomic<bool> cancelled = false;
+  // progress, in whatever unit the command counts
+  std::atomic<size_t> done = 0;
+  std::atomic<size_t> total = 0;
+
+  // to the terminal for a command run in the foreground
+  bool background = false;
+  std::ostringstream log;
+  std::ostringstream errors;
+
+  std::ostream& out() {
+    return background ? log : std::cout;
+  }
+
+  std::ostream& err() {
+    return background ? errors : std::cerr;
+  }
+};
+
+// returns false when the command failed
+typedef std::function<bool(Job&)> Task;
+
+class Jobs {
+
+public:
+  ~Jobs();
+
+  // returns the number of the job
+  int start(std::string command, Task task);
+  void list();
+  // false if there is no such job
+  bool wait(int n);
+  void waitAll();
+  bool cancel(int n);
+  // messages and state of the jobs that ended, which are then forgotten
+  void report();
+
+private:
+  struct Entry {
+    Job job;
+    std::thread thread;
+  };
+
+  void report(int n, Entry& entry);
+
+  std::map<int, std::unique_ptr<Entry>> jobs_;
+  int next_ = 1;
+};
+
+} // namespace genea
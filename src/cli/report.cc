@@ -0,0 +1,155 @@
+#include "report.h"
+#include "tree.h"
+#include "bigcount.h"
+#include "output.h"
+
+#include <algorithm>
+#include <unordered_set>
+
+namespace genea {
+
+namespace report {
+
+// written out once this large, the first ones sooner so that a long register
+// shows from the start
+static const size_t firstChunkBytes = 1 << 8;
+static const size_t chunkBytes = 1 << 16;
+
+
+static void line(std::string& out, size_t& chunk, std::string_view number, const struct Person& p, bool repeated) {
+  out += number;
+  out += " ID ";
+  Date::append(out, p.id);
+  out += ' ';
+  out += p.firstName_;
+  out += ' ';
+  out += p.lastName_;
+  out += p.sex_ == Sex::MALE ? " (M) " : " (F) ";
+  p.born_.format(out);
+  out += " - ";
+  if (p.dead_)
+    p.dead_->format(out);
+  if (repeated)
+    out += " (see above)";
+  out += '\n';
+  if (out.size() >= chunk) {
+    output::write(out);
+    out.clear();
+    chunk = std::min(chunk * 2, chunkBytes);
+  }
+}
+
+void descendants(Tree& tree, const std::shared_ptr<struct Person>& start, size_t depth) {
+  struct Frame {
+    std::vector<std::shared_ptr<struct Person>> children;
+    size_t next = 0;
+    // length of the number of the person
+    size_t length;
+  };
+  std::unordered_set<int> seen;
+  std::vector<Frame> stack;
+  std::string number = "1";
+  std::string out;
+  size_t chunk = firstChunkBytes;
+  auto visit = [&](struct Person& p) {
+    bool repeated = !seen.insert(p.id).second;
+    line(out, chunk, number, p, repeated);
+    if (repeated || stack.size() >= depth)
+      return;
+    Frame frame;
+    frame.length = number.size();
+    for (int id : p.children_) {
+      if (std::shared_ptr<struct Person> child = tree.person(id))
+        frame.children.push_back(std::move(child));
+    }
+    // unknown years last
+    std::stable_sort(frame.children.begin(), frame.children.end(), [](const std::shared_ptr<struct Person>& a, const std::shared_ptr<struct Person>& b) {
+      return (unsigned)a->born_.year_ < (unsigned)b->born_.year_;
+    });
+    stack.push_back(std::move(frame));
+  };
+  visit(*start);
+  while (stack.size()) {
+    Frame& frame = stack.back();
+    if (frame.next == frame.children.size()) {
+      stack.pop_back();
+      continue;
+    }
+    std::shared_ptr<struct Person> child = frame.children[frame.next++];
+    number.resize(frame.length);
+    number += '.';
+    Date::append(number, frame.next);
+    visit(*child);
+  }
+  output::write(out);
+}
+
+void ancestors(Tree& tree, const std::shared_ptr<struct Person>& start, size_t depth) {
+  struct Frame {
+    std::shared_ptr<struct Person> person;
+    // father, then mother, then done
+    int next = 0;
+  };
+  std::unordered_set<int> seen;
+  std::vector<Frame> stack;
+  // the number in binary is 1 then the path, 0 for fathers and 1 for mothers
+  std::vector<uint32_t> number = { 1 };
+  auto shift = [&](int bit) {
+    uint32_t carry = bit;
+    for (auto& limb : number) {
+      uint32_t next = limb >> 31;
+      limb = limb << 1 | carry;
+      carry = next;
+    }
+    if (carry)
+      number.push_back(carry);
+  };
+  auto unshift = [&]() {
+    for (size_t i = 0; i < number.size(); ++i)
+      number[i] = number[i] >> 1 | (i + 1 < number.size() ? number[i + 1] << 31 : 0);
+    if (number.size() > 1 && !number.back())
+      number.pop_back();
+  };
+  std::string digits;
+  std::string out;
+  size_t chunk = firstChunkBytes;
+  auto visit = [&](const std::shared_ptr<struct Person>& p) {
+    digits.clear();
+    if (number.size() <= 2) {
+      uint64_t n = number[0] | (number.size() > 1 ? (uint64_t)number[1] << 32 : 0);
+      digits = std::to_string(n);
+    } else {
+      digits = utils::BigCount(number.data(), number.size()).toString();
+    }
+    bool repeated = !seen.insert(p->id).second;
+    line(out, chunk, digits, *p, repeated);
+    if (!repeated && stack.size() < depth)
+      stack.push_back({ p });
+  };
+  visit(start);
+  while (stack.size()) {
+    Frame& frame = stack.back();
+    if (frame.next == 2) {
+      stack.pop_back();
+      // back to the number of the child below
+      if (stack.size())
+        unshift();
+      continue;
+    }
+    int bit = frame.next++;
+    std::shared_ptr<struct Person> parent = tree.person(bit ? frame.person->mother_ : frame.person->father_);
+    if (!parent)
+      continue;
+    shift(bit);
+    size_t before = stack.size();
+    visit(parent);
+    // a parent that was not expanded is done at once
+    if (stack.size() == before)
+      unshift();
+  }
+  output::write(out);
+}
+
+} // namespace report
+
+} // namespace genea
@@ -0,0 +1,27 @@
+#pragma once
+
+#include "person.h"
+#include <vector>
+#include <memory>
+
+namespace genea {
+
+class Tree;
+
+/*
+ * Registers of the descendants or ancestors of a person, one line each
+ * Traversals are depth first with an explicit stack, lines are written as
+ * they are numbered, so memory follows the depth rather than the size of the
+ * tree (with the people reached, to list those reached twice only once).
+ * People of a lazy tree are read as they are reached
+ */
+namespace report {
+
+// d'Aboville numbers: the person is 1, the children of n are n.1, n.2... by birth
+void descendants(Tree& tree, const std::shared_ptr<struct Person>& start, size_t depth);
+// Sosa-Stradonitz numbers: the person is 1, the parents of n are 2n and 2n+1
+void ancestors(Tree& tree, const std::shared_ptr<struct Person>& start, size_t depth);
+
+} // namespace report
+
+} // namespace genea
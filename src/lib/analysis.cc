@@ -0,0 +1,377 @@
+#include "analysis.h"
+#include "tree.h"
+#include "output.h"
+#include "parallel.h"
+
+#include <algorithm>
+#include <unordered_map>
+#include <cstdio>
+
+namespace genea {
+
+namespace analysis {
+
+static const size_t chunkPeople = 1 << 16;
+
+
+struct Partial {
+  Report report;
+  std::unordered_map<std::string_view, size_t> surnames;
+};
+
+static void reduce(Partial& partial, const std::vector<std::shared_ptr<struct Person>>& people, int id, int rank) {
+  const struct Person& p = *people[id];
+  Report& r = partial.report;
+  r.people++;
+  if (p.sex_ == Sex::MALE)
+    r.males++;
+  if (rank < 0) {
+    r.unranked++;
+  } else {
+    if ((size_t)rank >= r.generations.size())
+      r.generations.resize(rank + 1, { 0, 0 });
+    r.generations[rank][p.sex_ == Sex::MALE ? 0 : 1]++;
+  }
+  if (p.dead_ && p.dead_->year_ != -1 && p.born_.year_ != -1 && p.dead_->year_ >= p.born_.year_)
+    r.lifespans[std::min(p.dead_->year_ - p.born_.year_, maxLifespan)]++;
+  partial.surnames[p.lastName_]++;
+
+  // a couple is counted once, from the father of its children
+  std::vector<int> mothers;
+  for (int child : p.children_) {
+    const struct Person& c = *people[child];
+    if (c.father_ != id || c.mother_ == -1)
+      continue;
+    r.coupleChildren++;
+    if (std::find(mothers.begin(), mothers.end(), c.mother_) == mothers.end())
+      mothers.push_back(c.mother_);
+  }
+  r.couples += mothers.size();
+}
+
+static void merge(Partial& into, const Partial& from) {
+  Report& a = into.report;
+  const Report& b = from.report;
+  a.people += b.people;
+  a.males += b.males;
+  a.unranked += b.unranked;
+  if (a.generations.size() < b.generations.size())
+    a.generations.resize(b.generations.size(), { 0, 0 });
+  for (size_t g = 0; g < b.generations.size(); ++g) {
+    a.generations[g][0] += b.generations[g][0];
+    a.generations[g][1] += b.generations[g][1];
+  }
+  for (size_t y = 0; y < b.lifespans.size(); ++y)
+    a.lifespans[y] += b.lifespans[y];
+  a.couples += b.couples;
+  a.coupleChildren += b.coupleChildren;
+  for (auto& [name, count] : from.surnames)
+    into.surnames[name] += count;
+}
+
+Report analyze(const std::vector<std::shared_ptr<struct Person>>& people, const std::vector<int>& ranks) {
+  size_t n = people.size();
+  std::vector<Partial> partials((n + chunkPeople - 1) / chunkPeople);
+  utils::parallelFor(partials.size(), [&](size_t c) {
+    for (size_t i = c * chunkPeople; i < std::min(n, (c + 1) * chunkPeople); ++i)
+      reduce(partials[c], people, i, ranks[i]);
+  });
+
+  // pairwise merges, log(chunks) rounds over all cores
+  for (size_t step = 1; step < partials.size(); step *= 2) {
+    utils::parallelFor((partials.size() + 2 * step - 1) / (2 * step), [&](size_t i) {
+      if (2 * i * step + step < partials.size())
+        merge(partials[2 * i * step], partials[2 * i * step + step]);
+    });
+  }
+  if (partials.empty())
+    return Report();
+  Report res = std::move(partials[0].report);
+  res.surnames.assign(partials[0].surnames.begin(), partials[0].surnames.end());
+  std::sort(res.surnames.begin(), res.surnames.end(), [](auto& a, auto& b) {
+    return a.second != b.second ? a.second > b.second : a.first < b.first;
+  });
+  return res;
+}
+
+void print(const Report& report, size_t surnames) {
+  std::string out;
+  char buf[64];
+  auto line = [&](const char* format, auto... values) {
+    snprintf(buf, sizeof(buf), format, values...);
+    out += buf;
+  };
+
+  size_t females = report.people - report.males;
+  line("People: %zu (%zu M, %zu F", report.people, report.males, females);
+  if (females)
+    line(", %.2f M/F", (double)report.males / females);
+  out += ")\n";
+
+  out += "Generations, oldest first:\n";
+  for (size_t g = 0; g < report.generations.size(); ++g)
+    line("  %zu: %zu (%zu M, %zu F)\n", g, report.generations[g][0] + report.generations[g][1], report.generations[g][0], report.generations[g][1]);
+  if (report.unranked)
+    line("  unrelated: %zu\n", report.unranked);
+
+  size_t known = 0;
+  size_t years = 0;
+  for (int y = 0; y <= maxLifespan; ++y) {
+    known += report.lifespans[y];
+    years += report.lifespans[y] * y;
+  }
+  line("Lifespans: %zu known", known);
+  if (known) {
+    size_t seen = 0;
+    int median = 0;
+    while ((seen += report.lifespans[median]) * 2 < known)
+      median++;
+    line(", mean %.1f, median %d", (double)years / known, median);
+  }
+  out += '\n';
+  for (int decade = 0; decade <= maxLifespan; decade += 10) {
+    size_t count = 0;
+    for (int y = decade; y < std::min(decade + 10, maxLifespan + 1); ++y)
+      count += report.lifespans[y];
+    if (count == 0)
+      continue;
+    if (decade == maxLifespan)
+      line("  %d+: %zu\n", decade, count);
+    else
+      line("  %d-%d: %zu\n", decade, decade + 9, count);
+  }
+
+  line("Couples: %zu", report.couples);
+  if (report.couples)
+    line(", %.2f children per couple", (double)report.coupleChildren / report.couples);
+  out += '\n';
+
+  line("Surnames: %zu distinct\n", report.surnames.size());
+  for (size_t i = 0; i < std::min(surnames, report.surnames.size()); ++i) {
+    out += "  ";
+    out += report.surnames[i].first;
+    line(": %zu\n", report.surnames[i].second);
+  }
+  output::write(out);
+}
+
+namespace {
+
+/*
+ * The ancestors reached so far, numbered in the order they are, with their
+ * parents by number once read. A person is hashed when first reached only,
+ * generations then work on arrays as large as the ancestors
+ */
+struct Ancestors {
+  Ancestors(Tree& tree): tree(tree) {}
+
+  Tree& tree;
+  // by id in the tree
+  std::unordered_map<int, int> numbers;
+  std::vector<std::shared_ptr<struct Person>> people;
+  // -2 until read
+  std::vector<std::array<int, 2>> parents;
+
+  int number(int id) {
+    std::shared_ptr<struct Person> p = tree.person(id);
+    if (!p)
+      return -1;
+    auto [found, added] = numbers.try_emplace(id, people.size());
+    if (added) {
+      people.push_back(std::move(p));
+      parents.push_back({ -2, -2 });
+    }
+    return found->second;
+  }
+
+  const std::array<int, 2>& parentsOf(int i) {
+    if (parents[i][0] == -2) {
+      int father = number(people[i]->father_);
+      int mother = number(people[i]->mother_);
+      parents[i] = { father, mother };
+    }
+    return parents[i];
+  }
+
+  // among the people seen, by walking their parents depth first
+  bool loop(const std::vector<char>& seen) {
+    // 1 while on the path of the walk, 2 once all their ancestors are walked
+    std::vector<char> state(people.size(), 0);
+    // negative entries leave a person
+    std::vector<int> stack;
+    for (size_t root = 0; root < seen.size(); ++root) {
+      if (!seen[root] || state[root])
+        continue;
+      stack.push_back(root);
+      while (!stack.empty()) {
+        int v = stack.back();
+        stack.pop_back();
+        if (v < 0) {
+          state[~v] = 2;
+          continue;
+        }
+        if (state[v])
+          continue;
+        state[v] = 1;
+        stack.push_back(~v);
+        for (int parent : parentsOf(v)) {
+          if (parent < 0 || (size_t)parent >= seen.size() || !seen[parent])
+            continue;
+          if (state[parent] == 1)
+            return true;
+          if (!state[parent])
+            stack.push_back(parent);
+        }
+      }
+    }
+    return false;
+  }
+};
+
+} // namespace
+
+std::vector<Generation> collapse(Tree& tree, const std::shared_ptr<struct Person>& start, size_t depth, size_t top, size_t& distinct, bool& looped) {
+  std::vector<Generation> res;
+  Ancestors ancestors(tree);
+  std::vector<char> seen;
+  std::vector<int> ids = { ancestors.number(start ? start->id : -1) };
+  std::vector<uint32_t> counts = { 1 };
+  size_t width = 1;
+  // row of each ancestor of the next generation
+  std::vector<int> rows;
+  std::vector<int> nextIds;
+  std::vector<uint32_t> nextCounts;
+  distinct = 0;
+  looped = false;
+  bool checked = false;
+  while (res.size() < depth) {
+    // lines reaching the same ancestor are summed, two more limbs hold any sum
+    size_t wide = width + 2;
+    nextIds.clear();
+    nextCounts.clear();
+    auto reach = [&](int parent, const uint32_t* lines) {
+      if (parent < 0)
+        return;
+      if (rows.size() <= (size_t)parent)
+        rows.resize(ancestors.people.size(), -1);
+      int& row = rows[parent];
+      if (row < 0) {
+        row = nextIds.size();
+        nextIds.push_back(parent);
+        nextCounts.resize(nextIds.size() * wide, 0);
+      }
+      utils::BigCount::add(&nextCounts[row * wide], wide, lines, width);
+    };
+    for (size_t i = 0; i < ids.size(); ++i) {
+      std::array<int, 2> parents = ancestors.parentsOf(ids[i]);
+      reach(parents[0], &counts[i * width]);
+      reach(parents[1], &counts[i * width]);
+    }
+    for (int id : nextIds)
+      rows[id] = -1;
+    if (nextIds.empty())
+      break;
+
+    size_t used = 1;
+    for (size_t r = 0; r < nextIds.size(); ++r) {
+      for (size_t l = wide; l > used; --l) {
+        if (nextCounts[r * wide + l - 1]) {
+          used = l;
+          break;
+        }
+      }
+    }
+    for (size_t r = 0; r < nextIds.size(); ++r)
+      std::copy_n(&nextCounts[r * wide], used, &nextCounts[r * used]);
+    nextCounts.resize(nextIds.size() * used);
+    ids.swap(nextIds);
+    counts.swap(nextCounts);
+    width = used;
+
+    Generation gen;
+    gen.distinct = ids.size();
+    std::vector<uint32_t> total(width + 2, 0);
+    std::vector<uint32_t> repeated;
+    size_t before = distinct;
+    seen.resize(ancestors.people.size(), 0);
+    for (size_t r = 0; r < ids.size(); ++r) {
+      const uint32_t* row = &counts[r * width];
+      utils::BigCount::add(total.data(), total.size(), row, width);
+      if (row[0] > 1 || std::any_of(row + 1, row + width, [](uint32_t limb) { return limb; }))
+        repeated.push_back(r);
+      if (!seen[ids[r]]) {
+        seen[ids[r]] = true;
+        distinct++;
+      }
+    }
+    gen.lines = utils::BigCount(total.data(), total.size());
+    gen.repeated = repeated.size();
+
+    // rows have the same width, they compare from their most significant limb
+    auto more = [&](uint32_t a, uint32_t b) {
+      return std::lexicographical_compare(counts.rend() - (b + 1) * width, counts.rend() - b * width,
+                                          counts.rend() - (a + 1) * width, counts.rend() - a * width);
+    };
+    size_t shown = std::min(top, repeated.size());
+    auto& people = ancestors.people;
+    std::partial_sort(repeated.begin(), repeated.begin() + shown, repeated.end(), [&](uint32_t a, uint32_t b) {
+      return more(a, b) || (!more(b, a) && people[ids[a]]->id < people[ids[b]]->id);
+    });
+    for (size_t i = 0; i < shown; ++i)
+      gen.top.emplace_back(people[ids[repeated[i]]], utils::BigCount(&counts[repeated[i] * width], width));
+    res.push_back(std::move(gen));
+
+    // generations adding nobody only go on forever when parents loop, and
+    // the ancestors seen no longer change after the first one
+    if (distinct == before && !checked) {
+      checked = true;
+      looped = ancestors.loop(seen);
+      if (looped)
+        break;
+    }
+  }
+  return res;
+}
+
+void print(const std::vector<Generation>& generations, size_t distinct) {
+  std::string out;
+  char buf[64];
+  for (size_t g = 0; g < generations.size(); ++g) {
+    const Generation& gen = generations[g];
+    out += "Generation ";
+    Date::append(out, g + 1);
+    out += ": ";
+    Date::append(out, gen.distinct);
+    out += " distinct of ";
+    out += utils::BigCount::pow2(g + 1).toString();
+    out += " (";
+    out += gen.lines.toString();
+    snprintf(buf, sizeof(buf), " lines known, %.1f%% collapse)\n", 100 * (1 - gen.distinct / gen.lines.toDouble()));
+    out += buf;
+    for (size_t i = 0; i < gen.top.size(); ++i) {
+      const struct Person& p = *gen.top[i].first;
+      out += "  ID ";
+      Date::append(out, p.id);
+      out += ' ';
+      out += p.firstName_;
+      out += ' ';
+      out += p.lastName_;
+      out += " through ";
+      out += gen.top[i].second.toString();
+      out += " lines\n";
+    }
+    if (gen.repeated > gen.top.size()) {
+      out += "  ... and ";
+      Date::append(out, gen.repeated - gen.top.size());
+      out += " more\n";
+    }
+  }
+  out += "Distinct ancestors: ";
+  Date::append(out, distinct);
+  out += '\n';
+  output::write(out);
+}
+
+} // namespace analysis
+
+} // namespace genea
@@ -0,0 +1,67 @@
+#pragma once
+
+#include "person.h"
+#include "bigcount.h"
+#include <vector>
+#include <string>
+#include <string_view>
+#include <memory>
+#include <array>
+
+namespace genea {
+
+class Tree;
+
+/*
+ * Aggregates over the whole tree, computed in one pass
+ * Chunks of people are reduced into partial reports over all cores, partial
+ * reports are merged at the end
+ */
+namespace analysis {
+
+// lifespans are counted by year, the last bucket holds longer ones
+static const int maxLifespan = 120;
+
+struct Report {
+  size_t people = 0;
+  size_t males = 0;
+  // by generation, oldest first: males, females
+  std::vector<std::array<size_t, 2>> generations;
+  size_t unranked = 0;
+  std::vector<size_t> lifespans = std::vector<size_t>(maxLifespan + 1, 0);
+  size_t couples = 0;
+  size_t coupleChildren = 0;
+  // most frequent first
+  std::vector<std::pair<std::string_view, size_t>> surnames;
+};
+
+// ranks are generation numbers by id, -1 for people not ranked
+Report analyze(const std::vector<std::shared_ptr<struct Person>>& people, const std::vector<int>& ranks);
+void print(const Report& report, size_t surnames);
+
+/*
+ * Pedigree collapse: ancestors of a person by generation, with the number of
+ * lines through which each of them is reached
+ * The frontier of a generation holds each ancestor once with its count of
+ * lines, as a row of limbs wide enough for the largest count, so the work is
+ * linear in the number of distinct ancestors however large counts get. Only
+ * the ancestors reached are read, numbered as they are
+ */
+struct Generation {
+  size_t distinct = 0;
+  // ancestor slots of the generation that are known, out of 2^n
+  utils::BigCount lines;
+  // ancestors reached through several lines, and the ones with the most lines
+  size_t repeated = 0;
+  std::vector<std::pair<std::shared_ptr<struct Person>, utils::BigCount>> top;
+};
+
+// ancestors found in any generation are counted in distinct. Generations stop
+// at the first one adding nobody when parents loop among the ancestors, which
+// sets looped
+std::vector<Generation> collapse(Tree& tree, const std::shared_ptr<struct Person>& start, size_t depth, size_t top, size_t& distinct, bool& looped);
+void print(const std::vector<Generation>& generations, size_t distinct);
+
+} // namespace analysis
+
+} // namespace genea
@@ -0,0 +1,492 @@
+#include "archive.h"
+#include "parallel.h"
+
+#include <iostream>
+#include <fstream>
+#include <unordered_map>
+#include <string_view>
+#include <algorithm>
+#include <atomic>
+#include <cstring>
+#include <cstdint>
+
+namespace genea {
+
+namespace archive {
+
+static const std::string magic = "GENEAZ1\n";
+static const size_t blockPeople = 1 << 16;
+// bounds of decompressed sizes: the varints of a person in every column with
+// those of the column sizes, and the expansion of the dictionary
+static const uint64_t personBytes = 12 * 10;
+static const uint64_t columnBytes = 6 * 10;
+static const uint64_t dictExpansion = 1 << 10;
+
+
+static void putVarint(std::string& out, uint64_t v) {
+  while (v >= 0x80) {
+    out.push_back((char)(v | 0x80));
+    v >>= 7;
+  }
+  out.push_back((char)v);
+}
+
+static bool getVarint(const char*& cur, const char* end, uint64_t& v) {
+  v = 0;
+  for (int shift = 0; cur < end && shift < 64; shift += 7) {
+    uint8_t byte = *cur++;
+    v |= (uint64_t)(byte & 0x7f) << shift;
+    if (!(byte & 0x80))
+      return true;
+  }
+  return false;
+}
+
+static uint64_t zigzag(int64_t v) {
+  return ((uint64_t)v << 1) ^ (uint64_t)(v >> 63);
+}
+
+static int64_t unzigzag(uint64_t v) {
+  return (int64_t)(v >> 1) ^ -(int64_t)(v & 1);
+}
+
+
+/*
+ * LZ codec: a stream of (literal count, literals, match length, match offset)
+ * sequences ended by a zero match length
+ */
+std::string compress(const std::string& in) {
+  std::string out;
+  putVarint(out, in.size());
+  const char* src = in.data();
+  size_t n = in.size();
+  std::vector<int64_t> table(1 << 16, -1);
+  size_t anchor = 0;
+  size_t i = 0;
+  while (i + 4 <= n) {
+    uint32_t word;
+    uint32_t candWord;
+    memcpy(&word, src + i, 4);
+    uint32_t h = (word * 2654435761u) >> 16;
+    int64_t cand = table[h];
+    table[h] = i;
+    if (cand < 0 || (memcpy(&candWord, src + cand, 4), candWord != word)) {
+      i++;
+      continue;
+    }
+    size_t len = 4;
+    while (i + len < n && src[cand + len] == src[i + len])
+      len++;
+    putVarint(out, i - anchor);
+    out.append(src + anchor, i - anchor);
+    putVarint(out, len);
+    putVarint(out, i - cand);
+    i += len;
+    anchor = i;
+  }
+  putVarint(out, n - anchor);
+  out.append(src + anchor, n - anchor);
+  putVarint(out, 0);
+  return out;
+}
+
+bool decompress(const std::string& in, std::string& out, uint64_t max) {
+  const char* end = in.data() + in.size();
+  uint64_t size, literals, len, offset;
+  // the sequences are checked before the output is allocated, so that a
+  // corrupted size is not taken as is
+  for (bool check : { true, false }) {
+    const char* cur = in.data();
+    if (!getVarint(cur, end, size) || size > max)
+      return false;
+    if (!check)
+      out.assign(size, '\0');
+    size_t pos = 0;
+    while (true) {
+      if (!getVarint(cur, end, literals) || literals > (uint64_t)(end - cur) || literals > size - pos)
+        return false;
+      if (!check)
+        memcpy(&out[pos], cur, literals);
+      pos += literals;
+      cur += literals;
+      if (!getVarint(cur, end, len))
+        return false;
+      if (!len)
+        break;
+      if (!getVarint(cur, end, offset) || !offset || offset > pos || len > size - pos)
+        return false;
+      if (check) {
+        pos += len;
+        continue;
+      }
+      // byte by byte: a match may overlap what it produces
+      for (size_t k = 0; k < len; ++k, ++pos)
+        out[pos] = out[pos - offset];
+    }
+    if (pos != size)
+      return false;
+  }
+  return true;
+}
+
+
+// a link to someone outside of the people written is not stored
+static int linked(const std::vector<std::shared_ptr<struct Person>>& people, int id) {
+  return id >= 0 && (size_t)id < people.size() ? id : -1;
+}
+
+// parents first, then children, so that ids deltas stay small
+static std::vector<int> traversalOrder(const std::vector<std::shared_ptr<struct Person>>& people) {
+  std::vector<int> order;
+  std::vector<char> state(people.size(), 0);
+  std::vector<int> stack;
+  order.reserve(people.size());
+  for (size_t root = 0; root < people.size(); ++root) {
+    if (state[root])
+      continue;
+    stack.push_back(root);
+    state[root] = 1;
+    while (stack.size()) {
+      int id = stack.back();
+      struct Person* p = people[id].get();
+      bool ready = true;
+      for (int parent : { linked(people, p->father_), linked(people, p->mother_) }) {
+        if (parent != -1 && !state[parent]) {
+          stack.push_back(parent);
+          state[parent] = 1;
+          ready = false;
+        }
+      }
+      if (!ready)
+        continue;
+      stack.pop_back();
+      state[id] = 2;
+      order.push_back(id);
+      for (auto it = p->children_.rbegin(); it != p->children_.rend(); ++it) {
+        int child = linked(people, *it);
+        if (child != -1 && !state[child]) {
+          stack.push_back(child);
+          state[child] = 1;
+        }
+      }
+    }
+  }
+  return order;
+}
+
+static uint8_t dateMask(const struct Date& d) {
+  return (d.year_ != -1) | (d.month_ != -1) << 1 | (d.day_ != -1) << 2;
+}
+
+enum Column { NAMES, SEX, KINDS, YEARS, DATES, PARENTS, COLUMNS };
+
+static std::string encodeBlock(
+  const std::vector<std::shared_ptr<struct Person>>& people,
+  const std::vector<int>& order,
+  const std::vector<int>& rank,
+  const std::unordered_map<std::string_view, uint64_t>& codes,
+  size_t begin,
+  size_t end
+) {
+  std::string cols[COLUMNS];
+  cols[SEX].assign((end - begin + 7) / 8, '\0');
+  for (size_t k = begin; k < end; ++k) {
+    const struct Person& p = *people[order[k]];
+    putVarint(cols[NAMES], codes.at(p.firstName_));
+    putVarint(cols[NAMES], codes.at(p.lastName_));
+    if (p.sex_ == Sex::FEMALE)
+      cols[SEX][(k - begin) / 8] |= 1 << ((k - begin) % 8);
+    uint8_t kinds = dateMask(p.born_) | (p.dead_ ? 8 | dateMask(*p.dead_) << 4 : 0);
+    cols[KINDS].push_back(kinds);
+
+    // birth year against an already stored parent, death year against birth
+    if (kinds & 1) {
+      int ref = 0;
+      for (int parent : { linked(people, p.father_), linked(people, p.mother_) }) {
+        if (!ref && parent != -1 && rank[parent] < (int)k && people[parent]->born_.year_ != -1)
+          ref = people[parent]->born_.year_;
+      }
+      putVarint(cols[YEARS], zigzag((int64_t)p.born_.year_ - ref));
+    }
+    if (kinds & 16)
+      putVarint(cols[YEARS], zigzag((int64_t)p.dead_->year_ - (kinds & 1 ? p.born_.year_ : 0)));
+    if (kinds & 2)
+      putVarint(cols[DATES], zigzag(p.born_.month_));
+    if (kinds & 4)
+      putVarint(cols[DATES], zigzag(p.born_.day_));
+    if (kinds & 32)
+      putVarint(cols[DATES], zigzag(p.dead_->month_));
+    if (kinds & 64)
+      putVarint(cols[DATES], zigzag(p.dead_->day_));
+
+    for (int parent : { linked(people, p.father_), linked(people, p.mother_) })
+      putVarint(cols[PARENTS], parent != -1 ? zigzag((int64_t)rank[parent] - (int64_t)k) + 1 : 0);
+  }
+  std::string raw;
+  for (auto& col : cols) {
+    putVarint(raw, col.size());
+    raw += col;
+  }
+  return compress(raw);
+}
+
+bool isArchive(const std::string& file) {
+  std::ifstream in(file, std::ios::binary);
+  std::string head(magic.size(), '\0');
+  in.read(&head[0], head.size());
+  return in.good() && head == magic;
+}
+
+bool write(const std::string& file, const std::vector<std::shared_ptr<struct Person>>& people) {
+  std::ofstream out(file, std::ios::binary);
+  if (!out.good())
+    return false;
+  size_t n = people.size();
+  std::vector<int> order = traversalOrder(people);
+  std::vector<int> rank(n);
+  for (size_t k = 0; k < n; ++k)
+    rank[order[k]] = k;
+
+  // most frequent names get the shortest codes
+  std::unordered_map<std::string_view, uint64_t> codes;
+  for (auto& p : people) {
+    codes[p->firstName_]++;
+    codes[p->lastName_]++;
+  }
+  std::vector<std::pair<uint64_t, std::string_view>> names;
+  names.reserve(codes.size());
+  for (auto& [name, count] : codes)
+    names.push_back({ count, name });
+  std::sort(names.begin(), names.end(), [](auto& a, auto& b) {
+    return a.first != b.first ? a.first > b.first : a.second < b.second;
+  });
+  std::string dict;
+  putVarint(dict, names.size());
+  for (size_t i = 0; i < names.size(); ++i) {
+    codes[names[i].second] = i;
+    putVarint(dict, names[i].second.size());
+    dict += names[i].second;
+  }
+
+  size_t nblocks = (n + blockPeople - 1) / blockPeople;
+  std::vector<std::string> blocks(nblocks);
+  utils::parallelFor(nblocks, [&](size_t b) {
+    blocks[b] = encodeBlock(people, order, rank, codes, b * blockPeople, std::min(n, (b + 1) * blockPeople));
+  });
+
+  std::string header = magic;
+  putVarint(header, n);
+  putVarint(header, blockPeople);
+  dict = compress(dict);
+  putVarint(header, dict.size());
+  out << header << dict;
+  for (auto& block : blocks) {
+    header.clear();
+    putVarint(header, block.size());
+    out << header << block;
+  }
+  out.close();
+  return out.good();
+}
+
+
+// decoded columns, indexed by archive id
+struct Columns {
+  std::vector<uint32_t> first, last;
+  std::vector<uint8_t> female, kinds;
+  std::vector<int> born, dead;
+  std::vector<int> bornMonth, bornDay, deadMonth, deadDay;
+  std::vector<int> father, mother;
+
+  Columns(size_t n):
+  first(n), last(n), female(n), kinds(n), born(n, -1), dead(n, -1),
+  bornMonth(n, -1), bornDay(n, -1), deadMonth(n, -1), deadDay(n, -1),
+  father(n, -1), mother(n, -1) {}
+};
+
+static bool decodeBlock(const std::string& raw, Columns& cols, size_t nDict, size_t n, size_t begin, size_t end) {
+  const char* cur = raw.data();
+  const char* rawEnd = cur + raw.size();
+  const char* col[COLUMNS];
+  const char* colEnd[COLUMNS];
+  for (int c = 0; c < COLUMNS; ++c) {
+    uint64_t len;
+    if (!getVarint(cur, rawEnd, len) || len > (uint64_t)(rawEnd - cur))
+      return false;
+    col[c] = cur;
+    colEnd[c] = cur + len;
+    cur += len;
+  }
+  if ((size_t)(colEnd[SEX] - col[SEX]) < (end - begin + 7) / 8 || (size_t)(colEnd[KINDS] - col[KINDS]) < end - begin)
+    return false;
+
+  uint64_t v;
+  for (size_t k = begin; k < end; ++k) {
+    size_t j = k - begin;
+    if (!getVarint(col[NAMES], colEnd[NAMES], v) || v >= nDict)
+      return false;
+    cols.first[k] = v;
+    if (!getVarint(col[NAMES], colEnd[NAMES], v) || v >= nDict)
+      return false;
+    cols.last[k] = v;
+    cols.female[k] = (col[SEX][j / 8] >> (j % 8)) & 1;
+    uint8_t kinds = col[KINDS][j];
+    cols.kinds[k] = kinds;
+
+    // years are still deltas here, they are resolved once all blocks are read
+    if (kinds & 1) {
+      if (!getVarint(col[YEARS], colEnd[YEARS], v))
+        return false;
+      cols.born[k] = unzigzag(v);
+    }
+    if (kinds & 16) {
+      if (!getVarint(col[YEARS], colEnd[YEARS], v))
+        return false;
+      cols.dead[k] = unzigzag(v);
+    }
+    std::pair<uint8_t, int*> dates[] = {
+      { 2, &cols.bornMonth[k] }, { 4, &cols.bornDay[k] }, { 32, &cols.deadMonth[k] }, { 64, &cols.deadDay[k] }
+    };
+    for (auto& [bit, field] : dates) {
+      if (kinds & bit) {
+        if (!getVarint(col[DATES], colEnd[DATES], v))
+          return false;
+        *field = unzigzag(v);
+      }
+    }
+
+    for (int* parent : { &cols.father[k], &cols.mother[k] }) {
+      if (!getVarint(col[PARENTS], colEnd[PARENTS], v))
+        return false;
+      if (!v)
+        continue;
+      int64_t id = (int64_t)k + unzigzag(v - 1);
+      if (id < 0 || id >= (int64_t)n)
+        return false;
+      *parent = id;
+    }
+  }
+  return true;
+}
+
+std::vector<std::shared_ptr<struct Person>> read(const std::string& file, std::string& error) {
+  std::ifstream in(file, std::ios::binary | std::ios::ate);
+  if (!in.good())
+    return {};
+  std::string data(in.tellg(), '\0');
+  in.seekg(0);
+  in.read(&data[0], data.size());
+  in.close();
+
+  const char* cur = data.data() + magic.size();
+  const char* end = data.data() + data.size();
+  uint64_t n, perBlock, size;
+  if (data.compare(0, magic.size(), magic) || !getVarint(cur, end, n) || !getVarint(cur, end, perBlock) || !perBlock || perBlock > blockPeople ||
+      !getVarint(cur, end, size) || size > (uint64_t)(end - cur)) {
+    error = "File is invalid or corrupted";
+    return {};
+  }
+
+  std::string raw;
+  std::vector<std::string> dict;
+  uint64_t nDict = 0;
+  const char* d = nullptr;
+  bool ok = decompress(std::string(cur, size), raw, size * dictExpansion);
+  if (ok) {
+    d = raw.data();
+    ok = getVarint(d, raw.data() + raw.size(), nDict);
+  }
+  for (uint64_t i = 0; ok && i < nDict; ++i) {
+    uint64_t len;
+    ok = getVarint(d, raw.data() + raw.size(), len) && len <= (uint64_t)(raw.data() + raw.size() - d);
+    if (ok) {
+      dict.emplace_back(d, len);
+      d += len;
+    }
+  }
+  cur += size;
+
+  // every block takes a byte at least, checked before anything is allocated
+  uint64_t nblocks = n / perBlock + (n % perBlock != 0);
+  if (nblocks > (uint64_t)(end - cur))
+    ok = false;
+  std::vector<std::string> blocks;
+  for (size_t b = 0; ok && b < nblocks; ++b) {
+    ok = getVarint(cur, end, size) && size <= (uint64_t)(end - cur);
+    if (ok) {
+      blocks.emplace_back(cur, size);
+      cur += size;
+    }
+  }
+  if (!ok) {
+    error = "File is invalid or corrupted";
+    return {};
+  }
+
+  // names, kinds and parents take a byte at least per person
+  std::atomic<bool> valid = true;
+  utils::parallelFor(nblocks, [&](size_t b) {
+    std::string raw;
+    uint64_t count = std::min<uint64_t>(perBlock, n - b * perBlock);
+    if (!decompress(blocks[b], raw, count * personBytes + columnBytes) || raw.size() / 5 < count)
+      valid = false;
+    blocks[b].swap(raw);
+  });
+  if (!valid) {
+    error = "File is invalid or corrupted";
+    return {};
+  }
+  Columns cols(n);
+  utils::parallelFor(nblocks, [&](size_t b) {
+    if (!decodeBlock(blocks[b], cols, dict.size(), n, b * perBlock, std::min<size_t>(n, (b + 1) * perBlock)))
+      valid = false;
+  });
+  if (!valid) {
+    error = "File is invalid or corrupted";
+    return {};
+  }
+
+  // a parent's birth year is always resolved before its children's
+  for (size_t k = 0; k < n; ++k) {
+    if (cols.kinds[k] & 1) {
+      int ref = 0;
+      for (int parent : { cols.father[k], cols.mother[k] }) {
+        if (!ref && parent >= 0 && parent < (int)k && (cols.kinds[parent] & 1))
+          ref = cols.born[parent];
+      }
+      cols.born[k] += ref;
+    }
+    if (cols.kinds[k] & 16)
+      cols.dead[k] += (cols.kinds[k] & 1 ? cols.born[k] : 0);
+  }
+
+  std::vector<std::shared_ptr<struct Person>> res(n);
+  utils::parallelFor(nblocks, [&](size_t b) {
+    for (size_t k = b * perBlock; k < std::min<size_t>(n, (b + 1) * perBlock); ++k) {
+      struct Date born = Date(cols.born[k], cols.bornMonth[k], cols.bornDay[k]);
+      Sex sex = cols.female[k] ? Sex::FEMALE : Sex::MALE;
+      if (cols.kinds[k] & 8) {
+        struct Date dead = Date(cols.dead[k], cols.deadMonth[k], cols.deadDay[k]);
+        res[k] = memory::makeShared<struct Person, memory::PEOPLE>(dict[cols.first[k]], dict[cols.last[k]], sex, born, dead);
+      } else {
+        res[k] = memory::makeShared<struct Person, memory::PEOPLE>(dict[cols.first[k]], dict[cols.last[k]], sex, born);
+      }
+      res[k]->id = k;
+    }
+  });
+  for (size_t k = 0; k < n; ++k) {
+    if (cols.father[k] >= 0) {
+      res[k]->father_ = cols.father[k];
+      res[cols.father[k]]->children_.push_back(k);
+    }
+    if (cols.mother[k] >= 0) {
+      res[k]->mother_ = cols.mother[k];
+      res[cols.mother[k]]->children_.push_back(k);
+    }
+  }
+  return res;
+}
+
+} // namespace archive
+
+} // namespace genea
@@ -0,0 +1,31 @@
+#pragma once
+
+#include "person.h"
+#include <vector>
+#include <string>
+#include <memory>
+#include <cstdint>
+
+namespace genea {
+
+/*
+ * Compact archival format
+ * People are numbered in traversal order (parents before children) and stored
+ * by columns: dictionary-coded names, bit-packed sex, dates delta-coded
+ * against a parent's birth year and parent ids as varint deltas from the
+ * person's own id. Columns are cut in blocks compressed with a built-in LZ codec,
+ * blocks are encoded and decoded in parallel
+ */
+namespace archive {
+
+bool isArchive(const std::string& file);
+bool write(const std::string& file, const std::vector<std::shared_ptr<struct Person>>& people);
+std::vector<std::shared_ptr<struct Person>> read(const std::string& file, std::string& error);
+
+std::string compress(const std::string& in);
+// fails on a corrupted input or one decompressing to more than max bytes
+bool decompress(const std::string& in, std::string& out, uint64_t max);
+
+} // namespace archive
+
+} // namespace genea
@@ -0,0 +1,88 @@
+#pragma once
+
+#include <vector>
+#include <string>
+#include <cstdint>
+
+namespace genea {
+
+namespace utils {
+
+/*
+ * Unsigned integer of any size, as base 2^32 limbs, least significant first
+ * Hot loops work on fixed-width rows of limbs with add(), values are only
+ * built for the results
+ */
+class BigCount {
+
+public:
+  BigCount() {}
+
+  BigCount(const uint32_t* limbs, size_t size): limbs_(limbs, limbs + size) {
+    while (limbs_.size() && !limbs_.back())
+      limbs_.pop_back();
+  }
+
+  static BigCount pow2(unsigned n) {
+    std::vector<uint32_t> limbs(n / 32 + 1, 0);
+    limbs.back() = uint32_t(1) << (n % 32);
+    return BigCount(limbs.data(), limbs.size());
+  }
+
+  // sum += value, sum must be wide enough to hold the result
+  static void add(uint32_t* sum, size_t sumSize, const uint32_t* value, size_t size) {
+    uint64_t carry = 0;
+    for (size_t i = 0; i < sumSize && (i < size || carry); ++i) {
+      carry += uint64_t(sum[i]) + (i < size ? value[i] : 0);
+      sum[i] = uint32_t(carry);
+      carry >>= 32;
+    }
+  }
+
+  bool operator<(const BigCount& other) const {
+    if (limbs_.size() != other.limbs_.size())
+      return limbs_.size() < other.limbs_.size();
+    for (size_t i = limbs_.size(); i-- > 0;) {
+      if (limbs_[i] != other.limbs_[i])
+        return limbs_[i] < other.limbs_[i];
+    }
+    return false;
+  }
+
+  double toDouble() const {
+    double res = 0;
+    for (size_t i = limbs_.size(); i-- > 0;)
+      res = res * 4294967296.0 + limbs_[i];
+    return res;
+  }
+
+  std::string toString() const {
+    if (limbs_.empty())
+      return "0";
+    // repeated division by 10^9
+    std::vector<uint32_t> n = limbs_;
+    std::string res;
+    while (n.size()) {
+      uint64_t rem = 0;
+      for (size_t i = n.size(); i-- > 0;) {
+        uint64_t cur = (rem << 32) | n[i];
+        n[i] = uint32_t(cur / 1000000000);
+        rem = cur % 1000000000;
+      }
+      while (n.size() && !n.back())
+        n.pop_back();
+      std::string digits = std::to_string(rem);
+      if (n.size())
+        digits.insert(0, 9 - digits.size(), '0');
+      res.insert(0, digits);
+    }
+    return res;
+  }
+
+private:
+  std::vector<uint32_t> limbs_;
+};
+
+} // namespace utils
+
+} // namespace genea
@@ -0,0 +1,70 @@
+#pragma once
+
+#include <string_view>
+#include <array>
+#include <utility>
+#include <cstdint>
+
+namespace genea {
+
+namespace utils {
+
+constexpr size_t perfectHashSize(size_t n) {
+  size_t m = 1;
+  while (m < 4 * n)
+    m <<= 1;
+  return m;
+}
+
+constexpr uint32_t hashKey(std::string_view key, uint32_t seed) {
+  uint32_t h = 2166136261u ^ seed;
+  for (char c : key) {
+    h ^= (uint8_t)c;
+    h *= 16777619u;
+  }
+  return h ^ (h >> 15);
+}
+
+/*
+ * Compile-time perfect hash table
+ * The seed is searched when the table is built so that every key gets its own
+ * slot: a lookup is one hash and one comparison
+ */
+template <typename T, size_t N, size_t M = perfectHashSize(N)>
+class PerfectHash {
+
+public:
+  constexpr PerfectHash(const std::pair<std::string_view, T> (&entries)[N]): entries_(), slots_(), seed_(0) {
+    for (size_t i = 0; i < N; ++i)
+      entries_[i] = entries[i];
+    while (!place())
+      seed_++;
+  }
+
+  constexpr const T* find(std::string_view key) const {
+    int slot = slots_[hashKey(key, seed_) & (M - 1)];
+    if (slot < 0 || entries_[slot].first != key)
+      return nullptr;
+    return &entries_[slot].second;
+  }
+
+private:
+  constexpr bool place() {
+    slots_.fill(-1);
+    for (size_t i = 0; i < N; ++i) {
+      int& slot = slots_[hashKey(entries_[i].first, seed_) & (M - 1)];
+      if (slot >= 0)
+        return false;
+      slot = i;
+    }
+    return true;
+  }
+
+  std::array<std::pair<std::string_view, T>, N> entries_;
+  std::array<int, M> slots_;
+  uint32_t seed_;
+};
+
+} // namespace utils
+
+} // namespace genea
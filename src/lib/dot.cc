@@ -0,0 +1,702 @@
+#include "dot.h"
+#include "parallel.h"
+
+#include <algorithm>
+#include <atomic>
+#include <csignal>
+#include <sys/wait.h>
+#include <spawn.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <cerrno>
+#include <thread>
+#include <chrono>
+#include <mutex>
+#include <fstream>
+#include <filesystem>
+
+namespace genea {
+
+namespace dot {
+
+// spouses of p with whom p has children, in the order of the children
+static std::vector<std::shared_ptr<struct Person>> spouses(const People& people, const std::shared_ptr<struct Person>& p) {
+  std::vector<std::shared_ptr<struct Person>> res;
+  for (int id : p->children_) {
+    const struct Person* child = byId(people, id);
+    if (!child || !byId(people, child->father_) || !byId(people, child->mother_))
+      continue;
+    auto& spouse = people[child->father_ == p->id ? child->mother_ : child->father_];
+    if (std::find(res.begin(), res.end(), spouse) == res.end())
+      res.push_back(spouse);
+  }
+  return res;
+}
+
+static uint64_t coupleKey(int a, int b) {
+  return (uint64_t)std::min(a, b) << 32 | (uint32_t)std::max(a, b);
+}
+
+Layout::Layout(const People& people, const std::vector<std::vector<std::shared_ptr<struct Person>>>& generations):
+people_(&people) {
+  int maxId = -1;
+  for (auto& generation : generations) {
+    for (auto& person : generation)
+      maxId = std::max(maxId, person->id);
+  }
+  // people of the generations are -2 until placed, spouses outside them are left out
+  nodeOf_.assign(maxId + 1, -1);
+  std::vector<int>& nodeOf = nodeOf_;
+  for (auto& generation : generations) {
+    for (auto& person : generation)
+      nodeOf[person->id] = -2;
+  }
+  ranks_.resize(generations.size());
+
+  struct Frame {
+    std::shared_ptr<struct Person> person;
+    std::vector<std::shared_ptr<struct Person>> spouses;
+    size_t next = 0;
+  };
+  std::vector<Frame> stack;
+  for (size_t r = 0; r < generations.size(); ++r) {
+    for (auto& person : generations[r]) {
+      if (nodeOf[person->id] != -2)
+        continue;
+      // the block of a person holds the spouses reached from them, depth first
+      int block = blocks_.size();
+      blocks_.emplace_back();
+      ranks_[r].push_back(block);
+      auto add = [&](const std::shared_ptr<struct Person>& p) {
+        nodeOf[p->id] = nodes_.size();
+        blocks_[block].push_back(nodes_.size());
+        nodes_.push_back({ p, -1, -1, (int)r });
+        stack.push_back({ p, spouses(people, p) });
+      };
+      add(person);
+      while (stack.size()) {
+        Frame& frame = stack.back();
+        if (frame.next == frame.spouses.size()) {
+          stack.pop_back();
+          continue;
+        }
+        std::shared_ptr<struct Person> p = frame.person;
+        std::shared_ptr<struct Person> spouse = frame.spouses[frame.next++];
+        if (spouse->id > maxId || nodeOf[spouse->id] != -2)
+          continue;
+        blocks_[block].push_back(couple(p->id, spouse->id, r));
+        add(spouse);
+      }
+    }
+  }
+
+  up_.resize(nodes_.size());
+  down_.resize(nodes_.size());
+  // couple nodes of spouses placed apart, to insert after the father
+  std::vector<std::vector<int>> after(nodes_.size());
+  for (auto& generation : generations) {
+    for (auto& person : generation) {
+      int from = -1;
+      if (has(person->father_) && has(person->mother_)) {
+        auto found = couples_.find(coupleKey(person->father_, person->mother_));
+        if (found != couples_.end()) {
+          from = found->second;
+        } else {
+          int father = nodeOf[person->father_];
+          from = couple(person->father_, person->mother_, nodes_[father].rank);
+          after[father].push_back(from);
+          up_.emplace_back();
+          down_.emplace_back();
+        }
+      } else if (has(person->father_)) {
+        from = nodeOf[person->father_];
+      } else if (has(person->mother_)) {
+        from = nodeOf[person->mother_];
+      }
+      if (from < 0)
+        continue;
+      int to = nodeOf[person->id];
+      edges_.emplace_back(from, to);
+      down_[from].push_back(to);
+      up_[to].push_back(from);
+    }
+  }
+
+  for (Block& block : blocks_) {
+    Block merged;
+    for (int node : block) {
+      merged.push_back(node);
+      if (node < (int)after.size())
+        merged.insert(merged.end(), after[node].begin(), after[node].end());
+    }
+    block.swap(merged);
+  }
+
+  pos_.resize(nodes_.size());
+  for (size_t r = 0; r < ranks_.size(); ++r)
+    place(r);
+}
+
+int Layout::couple(int a, int b, int rank) {
+  int node = nodes_.size();
+  nodes_.push_back({ nullptr, a, b, rank });
+  couples_[coupleKey(a, b)] = node;
+  return node;
+}
+
+bool Layout::has(int id) const {
+  return id >= 0 && id < (int)nodeOf_.size() && nodeOf_[id] >= 0;
+}
+
+int Layout::stub(std::string text, int tile, int rank, int block) {
+  int node = nodes_.size();
+  nodes_.push_back({ nullptr, -1, -1, rank, std::move(text), tile });
+  if (block < 0) {
+    block = blocks_.size();
+    blocks_.emplace_back();
+    ranks_[rank].push_back(block);
+  }
+  blocks_[block].push_back(node);
+  up_.emplace_back();
+  down_.emplace_back();
+  return node;
+}
+
+void Layout::link(const std::vector<int>& tiles, const std::vector<std::string>& files) {
+  files_ = files;
+  std::vector<int> blockOf(nodes_.size());
+  for (size_t b = 0; b < blocks_.size(); ++b) {
+    for (int node : blocks_[b])
+      blockOf[node] = b;
+  }
+  auto name = [](const struct Person& p) {
+    return std::string(p.firstName_) + ' ' + std::string(p.lastName_);
+  };
+  auto edge = [&](int from, int to) {
+    edges_.emplace_back(from, to);
+    down_[from].push_back(to);
+    up_[to].push_back(from);
+  };
+  size_t people = nodes_.size();
+  for (size_t node = 0; node < people; ++node) {
+    std::shared_ptr<struct Person> p = nodes_[node].person;
+    if (!p)
+      continue;
+    int rank = nodes_[node].rank;
+
+    // parents left out, above
+    std::string parents;
+    int tile = -1;
+    for (int id : { p->father_, p->mother_ }) {
+      const struct Person* parent = byId(*people_, id);
+      if (!parent || has(id))
+        continue;
+      parents += (parents.empty() ? "" : " & ") + name(*parent);
+      tile = id < (int)tiles.size() ? tiles[id] : -1;
+    }
+    if (tile >= 0)
+      edge(stub(parents, tile, std::max(rank - 1, 0), -1), node);
+
+    // children left out, below, by tile, from their father when both parents are here
+    std::vector<std::pair<int, int>> children;
+    for (int child : p->children_) {
+      if (has(child) || child < 0 || child >= (int)tiles.size() || tiles[child] < 0)
+        continue;
+      int father = (*people_)[child]->father_;
+      if (father != p->id && has(father))
+        continue;
+      auto found = std::find_if(children.begin(), children.end(), [&](auto& c) { return c.first == tiles[child]; });
+      if (found == children.end())
+        children.emplace_back(tiles[child], 1);
+      else
+        found->second++;
+    }
+    for (auto [other, count] : children)
+      edge(node, stub(std::to_string(count) + (count > 1 ? " children" : " child"), other, std::min<int>(rank + 1, ranks_.size() - 1), -1));
+
+    // spouses left out, next to the person
+    for (auto& spouse : spouses(*people_, p)) {
+      if (!has(spouse->id) && spouse->id < (int)tiles.size() && tiles[spouse->id] >= 0)
+        flat_.emplace_back(node, stub(name(*spouse), tiles[spouse->id], rank, blockOf[node]));
+    }
+  }
+  pos_.resize(nodes_.size());
+  for (size_t r = 0; r < ranks_.size(); ++r)
+    place(r);
+}
+
+void Layout::place(size_t rank) {
+  int pos = 0;
+  for (int block : ranks_[rank]) {
+    for (int node : blocks_[block])
+      pos_[node] = pos++;
+  }
+}
+
+void Layout::sweep(size_t rank, bool down) {
+  // blocks move to the median position of their neighbors on the fixed side,
+  // the barycenter breaks ties and blocks without neighbors keep their place
+  std::vector<int>& blocks = ranks_[rank];
+  std::vector<std::pair<double, double>> keys(blocks.size());
+  std::vector<int> positions;
+  for (size_t i = 0; i < blocks.size(); ++i) {
+    int block = blocks[i];
+    positions.clear();
+    for (int node : blocks_[block]) {
+      for (int other : down ? up_[node] : down_[node])
+        positions.push_back(pos_[other]);
+    }
+    if (positions.empty()) {
+      keys[i] = { pos_[blocks_[block][0]], pos_[blocks_[block][0]] };
+      continue;
+    }
+    std::sort(positions.begin(), positions.end());
+    size_t n = positions.size();
+    double median = n % 2 ? positions[n / 2] : (positions[n / 2 - 1] + positions[n / 2]) / 2.0;
+    double sum = 0;
+    for (int p : positions)
+      sum += p;
+    keys[i] = { median, sum / n };
+  }
+  std::vector<int> sorted(blocks.size());
+  for (size_t i = 0; i < sorted.size(); ++i)
+    sorted[i] = i;
+  std::stable_sort(sorted.begin(), sorted.end(), [&](int a, int b) {
+    return keys[a] < keys[b];
+  });
+  for (size_t i = 0; i < sorted.size(); ++i)
+    sorted[i] = blocks[sorted[i]];
+  blocks.swap(sorted);
+  place(rank);
+}
+
+void Layout::order(int passes) {
+  size_t best = crossings();
+  std::vector<std::vector<int>> bestRanks = ranks_;
+  for (int pass = 0; pass < passes && best; ++pass) {
+    bool down = pass % 2 == 0;
+    for (size_t i = 1; i < ranks_.size(); ++i)
+      sweep(down ? i : ranks_.size() - 1 - i, down);
+    size_t count = crossings();
+    if (count < best) {
+      best = count;
+      bestRanks = ranks_;
+    }
+  }
+  ranks_.swap(bestRanks);
+  for (size_t r = 0; r < ranks_.size(); ++r)
+    place(r);
+}
+
+size_t Layout::crossings() const {
+  // edges leaving each rank for the next one, as (upper, lower) positions
+  std::vector<std::vector<std::pair<int, int>>> between(ranks_.size());
+  for (auto [from, to] : edges_) {
+    int upper = nodes_[from].rank;
+    if (nodes_[to].rank == upper + 1)
+      between[upper].emplace_back(pos_[from], pos_[to]);
+  }
+  std::vector<size_t> sizes(ranks_.size(), 0);
+  for (const Node& node : nodes_)
+    sizes[node.rank]++;
+
+  // crossings are inversions of the lower positions once sorted by upper ones
+  std::atomic<size_t> total = 0;
+  utils::parallelFor(ranks_.size(), [&](size_t r) {
+    auto& edges = between[r];
+    if (edges.size() < 2 || r + 1 >= ranks_.size())
+      return;
+    std::sort(edges.begin(), edges.end());
+    std::vector<size_t> tree(sizes[r + 1] + 1, 0);
+    size_t count = 0;
+    for (size_t i = 0; i < edges.size(); ++i) {
+      // edges seen so far ending strictly right of this one
+      size_t before = 0;
+      for (int k = edges[i].second + 1; k > 0; k -= k & -k)
+        before += tree[k];
+      count += i - before;
+      for (size_t k = edges[i].second + 1; k < tree.size(); k += k & -k)
+        tree[k]++;
+    }
+    total += count;
+  });
+  return total;
+}
+
+void Layout::appendId(std::string& out, int node) const {
+  const Node& n = nodes_[node];
+  if (n.person) {
+    out += 'n';
+    out += std::to_string(n.person->id);
+  } else if (n.tile >= 0) {
+    out += 's';
+    out += std::to_string(node);
+  } else {
+    out += 'r';
+    out += std::to_string(std::min(n.a, n.b));
+    out += 'x';
+    out += std::to_string(std::max(n.a, n.b));
+  }
+}
+
+void Layout::write(FILE* out, const Options& options) const {
+  std::string buf;
+  auto flush = [&](bool force) {
+    if (force || buf.size() >= (1 << 16)) {
+      if (!options.cancel || !*options.cancel)
+        fwrite(buf.data(), 1, buf.size(), out);
+      buf.clear();
+    }
+  };
+  char line[160];
+  snprintf(line, sizeof(line), "graph [newrank=true, ranksep=3, concentrate=true, overlap=false, splines=true, ordering=out, mclimit=%g, remincross=%s]\n",
+           options.mclimit, options.remincross ? "true" : "false");
+  buf += "graph G {\n";
+  buf += line;
+  buf += "edge [dir=none]\n";
+
+  for (size_t r = 0; r < ranks_.size(); ++r) {
+    if (ranks_[r].empty())
+      continue;
+    buf += "subgraph gen" + std::to_string(r) + " {\nrank = same\n";
+    int prev = -1;
+    std::string chain;
+    for (int block : ranks_[r]) {
+      for (int node : blocks_[block]) {
+        const Node& n = nodes_[node];
+        if (n.person) {
+          buf += n.person->dot();
+        } else if (n.tile >= 0) {
+          appendId(buf, node);
+          buf += " [shape=note, style=dashed, label=\"";
+          for (char c : n.stub) {
+            if (c == '"' || c == '\\')
+              buf += '\\';
+            buf += c;
+          }
+          buf += "\\n(tile " + std::to_string(n.tile) + ")\"";
+          if (n.tile < (int)files_.size())
+            buf += ", URL=\"" + files_[n.tile] + '"';
+          buf += ']';
+        } else {
+          appendId(buf, node);
+          buf += " [shape=point, width=0.05]";
+        }
+        buf += '\n';
+        // invisible edges between neighbors fix the order of the rank
+        if (prev >= 0) {
+          appendId(chain, prev);
+          chain += "--";
+          appendId(chain, node);
+          chain += " [style=invis]\n";
+        }
+        prev = node;
+        flush(false);
+      }
+    }
+    buf += chain;
+    buf += "}\n";
+    flush(false);
+  }
+
+  // couples, then children in rank order so that ordering=out keeps them
+  for (size_t node = 0; node < nodes_.size(); ++node) {
+    const Node& n = nodes_[node];
+    if (n.person || n.tile >= 0)
+      continue;
+    buf += 'n' + std::to_string(n.a) + "--";
+    appendId(buf, node);
+    buf += "--n" + std::to_string(n.b) + '\n';
+    flush(false);
+  }
+  for (auto [a, b] : flat_) {
+    appendId(buf, a);
+    buf += "--";
+    appendId(buf, b);
+    buf += " [style=dashed]\n";
+    flush(false);
+  }
+  for (size_t r = 0; r < ranks_.size(); ++r) {
+    for (int block : ranks_[r]) {
+      for (int node : blocks_[block]) {
+        for (int child : down_[node]) {
+          appendId(buf, node);
+          buf += ":s--";
+          appendId(buf, child);
+          buf += ":n\n";
+        }
+        flush(false);
+      }
+    }
+  }
+  buf += "}\n";
+  flush(true);
+  fflush(out);
+}
+
+std::vector<int> tile(const People& people, const std::vector<std::vector<std::shared_ptr<struct Person>>>& generations, size_t limit, std::vector<int>& roots) {
+  int maxId = -1;
+  for (auto& generation : generations) {
+    for (auto& person : generation)
+      maxId = std::max(maxId, person->id);
+  }
+  std::vector<int> res(maxId + 1, -1);
+  std::vector<bool> included(maxId + 1, false);
+  for (auto& generation : generations) {
+    for (auto& person : generation)
+      included[person->id] = true;
+  }
+  auto in = [&](const std::shared_ptr<struct Person>& p) {
+    return p && p->id <= maxId && included[p->id];
+  };
+
+  // spanning forest, oldest first, in preorder
+  std::vector<int> order;
+  std::vector<int> parent(maxId + 1, -1);
+  std::vector<bool> seen(maxId + 1, false);
+  std::vector<std::vector<int>> kids(maxId + 1);
+  std::vector<std::shared_ptr<struct Person>> stack;
+  for (auto& generation : generations) {
+    for (auto& person : generation) {
+      if (seen[person->id])
+        continue;
+      seen[person->id] = true;
+      stack.push_back(person);
+      while (stack.size()) {
+        std::shared_ptr<struct Person> p = stack.back();
+        stack.pop_back();
+        order.push_back(p->id);
+        auto reach = [&](const std::shared_ptr<struct Person>& other) {
+          if (!in(other) || seen[other->id])
+            return;
+          seen[other->id] = true;
+          parent[other->id] = p->id;
+          kids[p->id].push_back(other->id);
+          stack.push_back(other);
+        };
+        // spouses are pushed last to stay in the tile of the person
+        for (auto it = p->children_.rbegin(); it != p->children_.rend(); ++it) {
+          if (const struct Person* child = byId(people, *it))
+            reach(people[child->id]);
+        }
+        for (auto& spouse : spouses(people, p))
+          reach(spouse);
+      }
+    }
+  }
+
+  // children first, the largest subtrees are cut off until the person fits
+  std::vector<size_t> size(maxId + 1, 1);
+  std::vector<bool> cut(maxId + 1, false);
+  for (size_t i = order.size(); i-- > 0;) {
+    int id = order[i];
+    size_t total = 1;
+    for (int kid : kids[id])
+      total += size[kid];
+    if (total > limit) {
+      std::vector<int> largest = kids[id];
+      std::sort(largest.begin(), largest.end(), [&](int a, int b) { return size[a] > size[b]; });
+      for (int kid : largest) {
+        if (total <= limit)
+          break;
+        cut[kid] = true;
+        total -= size[kid];
+      }
+    }
+    size[id] = total;
+  }
+
+  roots.clear();
+  size_t shared = limit;
+  for (int id : order) {
+    if (cut[id]) {
+      res[id] = roots.size();
+      roots.push_back(id);
+    } else if (parent[id] >= 0) {
+      res[id] = res[parent[id]];
+    } else {
+      if (shared + size[id] > limit) {
+        roots.push_back(id);
+        shared = 0;
+      }
+      shared += size[id];
+      res[id] = roots.size() - 1;
+    }
+  }
+  return res;
+}
+
+int render(const Layout& layout, std::string_view format, const std::string& file, const Options& options) {
+  // dot reads the graph from a pipe, the pipe is closed on exec so that
+  // concurrent renders do not keep each other's open
+  int fds[2];
+  if (pipe2(fds, O_CLOEXEC))
+    return -1;
+  std::string type = "-T" + std::string(format);
+  const char* argv[] = { "dot", type.c_str(), "-o", file.c_str(), nullptr };
+  posix_spawn_file_actions_t actions;
+  posix_spawn_file_actions_init(&actions);
+  posix_spawn_file_actions_adddup2(&actions, fds[0], STDIN_FILENO);
+  posix_spawn_file_actions_addopen(&actions, STDERR_FILENO, "/dev/null", O_WRONLY, 0);
+  pid_t pid;
+  int error = posix_spawnp(&pid, "dot", &actions, nullptr, (char* const*)argv, environ);
+  posix_spawn_file_actions_destroy(&actions);
+  close(fds[0]);
+  if (error) {
+    close(fds[1]);
+    return error == ENOENT ? 127 : -1;
+  }
+
+  // dot exiting early must not kill the shell while the graph is written,
+  // SIGPIPE is ignored while any render is running
+  static std::mutex mutex;
+  static int running = 0;
+  static struct sigaction previous;
+  {
+    std::lock_guard<std::mutex> lock(mutex);
+    if (running++ == 0) {
+      struct sigaction ignore = {};
+      ignore.sa_handler = SIG_IGN;
+      sigaction(SIGPIPE, &ignore, &previous);
+    }
+  }
+  FILE* out = fdopen(fds[1], "w");
+  layout.write(out, options);
+  fclose(out);
+  {
+    std::lock_guard<std::mutex> lock(mutex);
+    if (--running == 0)
+      sigaction(SIGPIPE, &previous, nullptr);
+  }
+
+  int status = 0;
+  bool killed = false;
+  while (true) {
+    pid_t done = waitpid(pid, &status, options.cancel && !killed ? WNOHANG : 0);
+    if (done == pid)
+      break;
+    if (done < 0 && errno != EINTR)
+      return -1;
+    if (done == 0 && *options.cancel) {
+      kill(pid, SIGTERM);
+      killed = true;
+    } else if (done == 0) {
+      std::this_thread::sleep_for(std::chrono::milliseconds(50));
+    }
+  }
+  return WIFEXITED(status) ? WEXITSTATUS(status) : -1;
+}
+
+static std::string escape(std::string_view text) {
+  std::string res;
+  for (char c : text) {
+    if (c == '&')
+      res += "&amp;";
+    else if (c == '<')
+      res += "&lt;";
+    else if (c == '>')
+      res += "&gt;";
+    else if (c == '"')
+      res += "&quot;";
+    else
+      res += c;
+  }
+  return res;
+}
+
+Tiles renderTiles(const People& everyone, const std::vector<std::vector<std::shared_ptr<struct Person>>>& generations, const std::string& file, size_t limit, const Options& options) {
+  Tiles res;
+  std::vector<int> roots;
+  std::vector<int> tiles = tile(everyone, generations, limit, roots);
+
+  std::filesystem::path path(file);
+  std::string extension = path.extension().string();
+  std::string format = extension == ".svg" ? "svg" : "png";
+  if (extension.empty())
+    extension = ".png";
+  std::string stem = path.stem().string();
+  std::vector<std::string> files;
+  for (size_t t = 0; t < roots.size(); ++t)
+    files.push_back(stem + '-' + std::to_string(t) + extension);
+  auto sibling = [&](const std::string& name) {
+    return (path.parent_path() / name).string();
+  };
+
+  // generations of each tile, with a rank above and below for stubs
+  std::vector<std::pair<size_t, size_t>> spans(roots.size(), { generations.size(), 0 });
+  std::vector<size_t> people(roots.size(), 0);
+  std::vector<std::shared_ptr<struct Person>> rootPeople(roots.size());
+  for (size_t r = 0; r < generations.size(); ++r) {
+    for (auto& person : generations[r]) {
+      if (person->id == roots[tiles[person->id]])
+        rootPeople[tiles[person->id]] = person;
+      auto& span = spans[tiles[person->id]];
+      span = { std::min(span.first, r), std::max(span.second, r) };
+      people[tiles[person->id]]++;
+    }
+  }
+  for (auto& span : spans)
+    span = { span.first ? span.first - 1 : 0, std::min(span.second + 1, generations.size() - 1) };
+  std::vector<std::vector<std::vector<std::shared_ptr<struct Person>>>> tileGenerations(roots.size());
+  for (size_t t = 0; t < roots.size(); ++t)
+    tileGenerations[t].resize(spans[t].second - spans[t].first + 1);
+  for (size_t r = 0; r < generations.size(); ++r) {
+    for (auto& person : generations[r]) {
+      int t = tiles[person->id];
+      tileGenerations[t][r - spans[t].first].push_back(person);
+    }
+  }
+
+  // each worker lays out its tile and feeds its own dot process
+  std::vector<int> statuses(roots.size(), 0);
+  std::atomic<size_t> rendered = 0;
+  utils::parallelFor(roots.size(), [&](size_t t) {
+    if (options.cancel && *options.cancel) {
+      statuses[t] = -1;
+      return;
+    }
+    Layout layout(everyone, tileGenerations[t]);
+    tileGenerations[t].clear();
+    layout.link(tiles, files);
+    layout.order(options.passes);
+    std::string target = sibling(files[t]);
+    statuses[t] = render(layout, format, target, options);
+    if (statuses[t] == 127) {
+      FILE* out = fopen((target + ".dot").c_str(), "w");
+      if (!out) {
+        statuses[t] = -1;
+        return;
+      }
+      layout.write(out, options);
+      fclose(out);
+    }
+    if (options.progress)
+      options.progress(++rendered, roots.size());
+  });
+  res.count = roots.size();
+  for (int status : statuses) {
+    if (status) {
+      res.status = status;
+      break;
+    }
+  }
+
+  std::string html = "<!DOCTYPE html>\n<html>\n<head><meta charset=\"utf-8\"><title>" + escape(stem) + "</title></head>\n<body>\n<ul>\n";
+  for (size_t t = 0; t < roots.size(); ++t) {
+    const struct Person& root = *rootPeople[t];
+    html += "<li><a href=\"" + escape(files[t]) + "\">Tile " + std::to_string(t) + "</a>: from ";
+    html += escape(std::string(root.firstName_) + ' ' + std::string(root.lastName_));
+    html += " (ID " + std::to_string(root.id) + "), " + std::to_string(people[t]) + " people</li>\n";
+  }
+  html += "</ul>\n</body>\n</html>\n";
+  res.index = sibling(stem + ".html");
+  std::ofstream out(res.index);
+  out << html;
+  if (!out.good())
+    res.status = -1;
+  return res;
+}
+
+} // namespace dot
+
+} // namespace genea
@@ -0,0 +1,121 @@
+#pragma once
+
+#include "person.h"
+#include <vector>
+#include <string>
+#include <string_view>
+#include <memory>
+#include <unordered_map>
+#include <cstdint>
+#include <cstdio>
+#include <atomic>
+#include <functional>
+
+namespace genea {
+
+/*
+ * Graph view of a tree for Graphviz
+ * People sit on the rank of their generation next to their spouses, a couple
+ * node between two spouses carries the edges to their children
+ * The order of each rank is computed here by median sweeps and fixed in the
+ * DOT output, so dot only has to place the nodes
+ */
+namespace dot {
+
+typedef std::vector<std::shared_ptr<struct Person>> People;
+
+struct Options {
+  // dot's own crossing minimization, little is left to do once ranks are ordered
+  double mclimit = 0.2;
+  bool remincross = false;
+  int passes = 8;
+  // set from another thread to stop: nothing more is written and dot is killed
+  const std::atomic<bool>* cancel = nullptr;
+  // called with the tiles rendered so far and their count
+  std::function<void(size_t, size_t)> progress;
+};
+
+class Layout {
+
+public:
+  // generations as returned by utils::generations, oldest first, among the
+  // people of their tree, whose links are read through it while it is alive
+  Layout(const People& people, const std::vector<std::vector<std::shared_ptr<struct Person>>>& generations);
+
+  // stub nodes for the people of other tiles linked to the people of this one,
+  // by tile of each id, stubs link to the files of their tiles
+  void link(const std::vector<int>& tiles, const std::vector<std::string>& files);
+
+  // alternating down and up sweeps, the order with the fewest crossings is kept
+  void order(int passes);
+  // crossings of the edges between adjacent ranks
+  size_t crossings() const;
+  void write(FILE* out, const Options& options) const;
+
+private:
+  struct Node {
+    // a person, the couple of two people by id, or a stub to another tile
+    std::shared_ptr<struct Person> person;
+    int a = -1;
+    int b = -1;
+    int rank = 0;
+    std::string stub = {};
+    int tile = -1;
+  };
+
+  // spouses stay next to each other, so ranks are ordered by blocks of nodes
+  typedef std::vector<int> Block;
+
+  int couple(int a, int b, int rank);
+  int stub(std::string text, int tile, int rank, int block);
+  bool has(int id) const;
+  void sweep(size_t rank, bool down);
+  void place(size_t rank);
+  void appendId(std::string& out, int node) const;
+
+  const People* people_;
+  std::vector<Node> nodes_;
+  // node of each person by id, -1 for people left out
+  std::vector<int> nodeOf_;
+  std::unordered_map<uint64_t, int> couples_;
+  std::vector<Block> blocks_;
+  // block ids of each rank, in order
+  std::vector<std::vector<int>> ranks_;
+  // position of each node in its rank
+  std::vector<int> pos_;
+  // parent (person or couple) to child edges, and the same edges by node
+  std::vector<std::pair<int, int>> edges_;
+  std::vector<std::vector<int>> up_;
+  std::vector<std::vector<int>> down_;
+  // edges within a rank between people and stubs
+  std::vector<std::pair<int, int>> flat_;
+  std::vector<std::string> files_;
+};
+
+/*
+ * Tiles of at most limit people for huge trees
+ * People are spanned by a forest from the oldest ones, through children and
+ * spouses, and subtrees are cut at the ancestors whose descendants no longer
+ * fit, largest first, small trees of the forest share tiles
+ * Returns the tile of each person by id (-1 for people left out), and the
+ * first person of each tile in roots
+ */
+std::vector<int> tile(const People& people, const std::vector<std::vector<std::shared_ptr<struct Person>>>& generations, size_t limit, std::vector<int>& roots);
+
+// pipes the DOT to dot, returns the exit status of dot (127 when it is missing)
+int render(const Layout& layout, std::string_view format, const std::string& file, const Options& options);
+
+struct Tiles {
+  size_t count = 0;
+  // 0, or the first failure of dot, 127 when DOT files were written instead
+  int status = 0;
+  std::string index;
+};
+
+// renders the tiles to <stem>-<n>.<ext> next to file, with a pool of dot
+// processes as large as the core count, and an HTML index to <stem>.html
+Tiles renderTiles(const People& people, const std::vector<std::vector<std::shared_ptr<struct Person>>>& generations, const std::string& file, size_t limit, const Options& options);
+
+} // namespace dot
+
+} // namespace genea
@@ -0,0 +1,246 @@
+#include "integrity.h"
+#include "tree.h"
+#include "parallel.h"
+
+#include <algorithm>
+#include <atomic>
+#include <unordered_map>
+#include <unordered_set>
+
+namespace genea {
+
+namespace integrity {
+
+static const size_t chunkPeople = 1 << 16;
+
+typedef std::vector<std::shared_ptr<struct Person>> People;
+
+static bool inTree(const People& people, int id) {
+  return id >= 0 && (size_t)id < people.size();
+}
+
+static int idOf(const People& people, int id) {
+  return inTree(people, id) ? id : -1;
+}
+
+static bool isChild(const struct Person& child, int id) {
+  return child.father_ == id || child.mother_ == id;
+}
+
+// as far as both dates are known
+static bool before(const struct Date& a, const struct Date& b) {
+  if (a.year_ == -1 || b.year_ == -1 || a.year_ != b.year_)
+    return a.year_ != -1 && b.year_ != -1 && a.year_ < b.year_;
+  if (a.month_ == -1 || b.month_ == -1 || a.month_ != b.month_)
+    return a.month_ != -1 && b.month_ != -1 && a.month_ < b.month_;
+  return a.day_ != -1 && b.day_ != -1 && a.day_ < b.day_;
+}
+
+// the parents of p in the tree, a parent who is both counted once
+static int parents(const People& people, const struct Person& p, int res[2]) {
+  int n = 0;
+  if (inTree(people, p.father_))
+    res[n++] = p.father_;
+  if (p.mother_ != p.father_ && inTree(people, p.mother_))
+    res[n++] = p.mother_;
+  return n;
+}
+
+/*
+ * Everything about a person but the cycles, returns the number of children
+ * they list properly: in the tree, having them as parent and listed once
+ */
+static int checkPerson(const People& people, int id, std::vector<Issue>& issues, std::vector<std::atomic<int>>& links) {
+  const struct Person& p = *people[id];
+  if (p.dead_ && before(*p.dead_, p.born_))
+    issues.push_back({ DEATH, id });
+  for (bool father : { true, false }) {
+    int link = father ? p.father_ : p.mother_;
+    if (link == -1)
+      continue;
+    if (!inTree(people, link)) {
+      issues.push_back({ FOREIGN, id, -1, father });
+      continue;
+    }
+    const struct Person* parent = people[link].get();
+    if (parent->sex_ != (father ? Sex::MALE : Sex::FEMALE))
+      issues.push_back({ SEX, id, parent->id, father });
+    if (before(p.born_, parent->born_))
+      issues.push_back({ BIRTH, id, parent->id, father });
+  }
+  int linked[2];
+  for (int i = parents(people, p, linked); i--;)
+    links[linked[i]]++;
+  const auto& children = p.children_;
+  // long lists of children are not searched again for each of them
+  std::unordered_set<int> seen;
+  int listed = 0;
+  for (size_t i = 0; i < children.size(); ++i) {
+    int child = children[i];
+    bool twice = false;
+    if (children.size() <= 16) {
+      for (size_t j = 0; j < i && !twice; ++j)
+        twice = children[j] == child;
+    } else {
+      twice = !seen.insert(child).second;
+    }
+    if (twice) {
+      issues.push_back({ DUPLICATE, id, idOf(people, child) });
+      continue;
+    }
+    if (!inTree(people, child) || !isChild(*people[child], id)) {
+      issues.push_back({ STRAY, id, idOf(people, child) });
+      continue;
+    }
+    listed++;
+  }
+  return listed;
+}
+
+// a parent still on the path of the walk is also a descendant
+static void cycles(const People& people, std::vector<Issue>& issues) {
+  std::vector<char> state(people.size(), 0);
+  // negative entries leave a person, once all their ancestors are walked
+  std::vector<int> stack;
+  for (size_t i = 0; i < people.size(); ++i) {
+    if (state[i])
+      continue;
+    stack.push_back(i);
+    while (!stack.empty()) {
+      int v = stack.back();
+      stack.pop_back();
+      if (v < 0) {
+        state[~v] = 2;
+        continue;
+      }
+      if (state[v])
+        continue;
+      state[v] = 1;
+      stack.push_back(~v);
+      const struct Person& p = *people[v];
+      for (bool father : { false, true }) {
+        int parent = father ? p.father_ : p.mother_;
+        if (!inTree(people, parent))
+          continue;
+        if (state[parent] == 1)
+          issues.push_back({ CYCLE, v, parent, father });
+        else if (!state[parent])
+          stack.push_back(parent);
+      }
+    }
+  }
+}
+
+std::vector<Issue> check(const People& people) {
+  size_t n = people.size();
+  size_t chunks = (n + chunkPeople - 1) / chunkPeople;
+  std::vector<std::vector<Issue>> found(chunks);
+  // links to each person from their children, and children they list properly
+  std::vector<std::atomic<int>> links(n);
+  std::vector<int> listed(n);
+  utils::parallelFor(chunks, [&](size_t c) {
+    for (size_t i = c * chunkPeople; i < std::min(n, (c + 1) * chunkPeople); ++i)
+      listed[i] = checkPerson(people, i, found[c], links);
+  });
+  // a person with fewer children listed than linked misses some of them
+  utils::parallelFor(chunks, [&](size_t c) {
+    for (size_t i = c * chunkPeople; i < std::min(n, (c + 1) * chunkPeople); ++i) {
+      int linked[2];
+      for (int k = parents(people, *people[i], linked); k--;) {
+        int parent = linked[k];
+        if (listed[parent] == links[parent])
+          continue;
+        const auto& children = people[parent]->children_;
+        if (std::find(children.begin(), children.end(), (int)i) == children.end())
+          found[c].push_back({ UNLISTED, (int)i, parent, parent == people[i]->father_ });
+      }
+    }
+  });
+  std::vector<Issue> res;
+  for (auto& issues : found)
+    res.insert(res.end(), issues.begin(), issues.end());
+  cycles(people, res);
+  std::stable_sort(res.begin(), res.end(), [](const Issue& a, const Issue& b) {
+    return a.id < b.id;
+  });
+  return res;
+}
+
+void repair(Tree& tree, std::vector<Issue>& issues) {
+  const People& people = tree.people();
+  // parents whose children are listed again
+  std::vector<char> relist(people.size(), 0);
+  // links first, so that parents are only swapped once they are right
+  for (auto& issue : issues) {
+    if (issue.kind != FOREIGN && issue.kind != CYCLE)
+      continue;
+    int link = issue.father ? people[issue.id]->father_ : people[issue.id]->mother_;
+    if (link != -1 && idOf(people, link) == issue.other) {
+      if (issue.other != -1)
+        relist[issue.other] = 1;
+      struct Person& p = *tree.edit(issue.id);
+      (issue.father ? p.father_ : p.mother_) = -1;
+    }
+    issue.repaired = true;
+  }
+  for (auto& issue : issues) {
+    if (issue.kind != SEX)
+      continue;
+    const struct Person& p = *people[issue.id];
+    Sex sex = issue.father ? Sex::MALE : Sex::FEMALE;
+    int slot = issue.father ? p.father_ : p.mother_;
+    int other = issue.father ? p.mother_ : p.father_;
+    auto sexOf = [&people](int id) {
+      return people[id]->sex_;
+    };
+    if (slot != -1 && sexOf(slot) != sex && (other == -1 || sexOf(other) == sex)) {
+      struct Person& edited = *tree.edit(issue.id);
+      std::swap(edited.father_, edited.mother_);
+      slot = other;
+    }
+    issue.repaired = slot == -1 || sexOf(slot) == sex;
+  }
+  for (auto& issue : issues) {
+    if (issue.kind == STRAY || issue.kind == DUPLICATE)
+      relist[issue.id] = 1;
+    else if (issue.kind == UNLISTED)
+      relist[issue.other] = 1;
+  }
+  std::unordered_map<int, std::vector<int>> expected;
+  for (size_t i = 0; i < people.size(); ++i) {
+    if (relist[i])
+      expected[i];
+  }
+  if (expected.empty())
+    return;
+  for (size_t i = 0; i < people.size(); ++i) {
+    int linked[2];
+    for (int k = parents(people, *people[i], linked); k--;) {
+      if (relist[linked[k]])
+        expected[linked[k]].push_back(i);
+    }
+  }
+  // children listed properly keep their order, the missing ones come last
+  for (auto& [id, children] : expected) {
+    struct Person& parent = *tree.edit(id);
+    std::unordered_set<int> left(children.begin(), children.end());
+    memory::vector<int, memory::LINKS> list;
+    for (int child : parent.children_) {
+      if (left.erase(child))
+        list.push_back(child);
+    }
+    for (int child : children) {
+      if (left.count(child))
+        list.push_back(child);
+    }
+    parent.children_.swap(list);
+  }
+  for (auto& issue : issues) {
+    if (issue.kind == STRAY || issue.kind == DUPLICATE || issue.kind == UNLISTED)
+      issue.repaired = true;
+  }
+}
+
+} // namespace integrity
+
+} // namespace genea
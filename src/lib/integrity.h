@@ -0,0 +1,61 @@
+#pragma once
+
+#include "person.h"
+#include <vector>
+#include <memory>
+
+namespace genea {
+
+class Tree;
+
+/*
+ * Integrity of a tree
+ * People are checked by chunks over all cores, each against their own links
+ * only, so that chunks need nothing from each other. Cycles of parents are
+ * then found by a single depth first walk along the parents, where a parent
+ * still on the path closes a cycle
+ */
+namespace integrity {
+
+enum Kind {
+  // the father is not a man, or the mother not a woman
+  SEX,
+  // the parent is also a descendant
+  CYCLE,
+  // born before the parent
+  BIRTH,
+  // dead before being born
+  DEATH,
+  // missing from the children of the parent
+  UNLISTED,
+  // among the children of someone who is not their parent
+  STRAY,
+  // among the children of someone more than once
+  DUPLICATE,
+  // the parent is not a person of the tree
+  FOREIGN
+};
+
+struct Issue {
+  Kind kind;
+  int id;
+  // the parent or the child concerned, -1 when not in the tree
+  int other = -1;
+  // the link concerned is the father, for the kinds about a parent
+  bool father = false;
+  bool repaired = false;
+};
+
+// by id
+std::vector<Issue> check(const std::vector<std::shared_ptr<struct Person>>& people);
+/*
+ * Parents of the wrong sex are swapped, or moved to the other parent when
+ * there is none. Links closing cycles or to people outside the tree are
+ * unset, and children are listed again from the parents they have. Dates are
+ * left as they are. Only the people changed are copied from forks
+ */
+void repair(Tree& tree, std::vector<Issue>& issues);
+
+} // namespace integrity
+
+} // namespace genea
@@ -0,0 +1,295 @@
+#include "kinship.h"
+#include "tree.h"
+
+#include <algorithm>
+#include <climits>
+
+namespace genea {
+
+namespace kinship {
+
+namespace {
+
+struct Visit {
+  int distance;
+  // the person it was reached from, toward the start
+  struct Person* from;
+};
+
+typedef memory::unordered_map<struct Person*, Visit, memory::TRAVERSALS> Visits;
+
+struct Side {
+  Side(struct Person* start) {
+    seen.emplace(start, Visit{ 0, nullptr });
+    frontier.push_back(start);
+  }
+
+  Visits seen;
+  std::vector<struct Person*> frontier;
+  int level = 0;
+};
+
+struct Meeting {
+  int length = INT_MAX;
+  struct Person* at = nullptr;
+};
+
+} // namespace
+
+static bool isParent(const struct Person* p, const struct Person* parent) {
+  return p->father_ == parent->id || p->mother_ == parent->id;
+}
+
+// grows the side by a level, through parents and also children when down,
+// returns the shortest meeting with the people reached from the other side
+static Meeting grow(Tree& tree, Side& side, const Side& other, bool down) {
+  Meeting best;
+  std::vector<struct Person*> next;
+  auto reach = [&](struct Person* p, int id) {
+    struct Person* q = tree.person(id).get();
+    if (!q || !side.seen.emplace(q, Visit{ side.level + 1, p }).second)
+      return;
+    next.push_back(q);
+    auto found = other.seen.find(q);
+    if (found != other.seen.end() && side.level + 1 + found->second.distance < best.length)
+      best = { side.level + 1 + found->second.distance, q };
+  };
+  for (struct Person* p : side.frontier) {
+    reach(p, p->father_);
+    reach(p, p->mother_);
+    if (down) {
+      for (int child : p->children_)
+        reach(p, child);
+    }
+  }
+  side.frontier = std::move(next);
+  side.level++;
+  return best;
+}
+
+// a side may still find a meeting as short as the best while it can grow up
+// to it, the side with the smaller frontier grows first
+static void search(Tree& tree, Side& a, Side& b, Meeting& best, bool down) {
+  while (true) {
+    bool growA = a.frontier.size() && a.level + 1 <= best.length;
+    bool growB = b.frontier.size() && b.level + 1 <= best.length;
+    // through children, a path no longer than the levels together was already met
+    if (down && (!a.frontier.size() || !b.frontier.size() || a.level + b.level + 1 >= best.length))
+      return;
+    if (!growA && !growB)
+      return;
+    bool first = growA && (!growB || a.frontier.size() <= b.frontier.size());
+    Meeting m = first ? grow(tree, a, b, down) : grow(tree, b, a, down);
+    if (m.length < best.length)
+      best = m;
+  }
+}
+
+// from a through the meeting person to b
+static std::vector<struct Person*> path(const Side& a, const Side& b, struct Person* at) {
+  std::vector<struct Person*> res;
+  for (struct Person* p = at; p; p = a.seen.at(p).from)
+    res.push_back(p);
+  std::reverse(res.begin(), res.end());
+  for (struct Person* p = b.seen.at(at).from; p; p = b.seen.at(p).from)
+    res.push_back(p);
+  return res;
+}
+
+Kinship relate(Tree& tree, struct Person* a, struct Person* b) {
+  Kinship res;
+  Side upA(a), upB(b);
+  Meeting blood;
+  if (a == b)
+    blood = { 0, a };
+  search(tree, upA, upB, blood, false);
+  if (blood.at) {
+    // the nearest common ancestors, closest to a first when the lines meet at
+    // different generations
+    res.up = INT_MAX;
+    for (auto& [p, visit] : upA.seen) {
+      auto found = upB.seen.find(p);
+      if (found == upB.seen.end() || visit.distance + found->second.distance != blood.length)
+        continue;
+      if (visit.distance < res.up) {
+        res.up = visit.distance;
+        res.ancestors.clear();
+      }
+      if (visit.distance == res.up)
+        res.ancestors.push_back(p);
+    }
+    res.down = blood.length - res.up;
+    std::sort(res.ancestors.begin(), res.ancestors.end(), [](struct Person* x, struct Person* y) { return x->id < y->id; });
+    blood.at = res.ancestors[0];
+    if (res.up && res.down && res.ancestors.size() == 1) {
+      // the other parent is known on both lines and is not the same
+      struct Person* x = upA.seen.at(blood.at).from;
+      struct Person* y = upB.seen.at(blood.at).from;
+      res.half = x->father_ != -1 && x->mother_ != -1 && y->father_ != -1 && y->mother_ != -1;
+    }
+  }
+  // a shorter path through children and spouses
+  Side anyA(a), anyB(b);
+  Meeting shortest = blood;
+  search(tree, anyA, anyB, shortest, true);
+  if (shortest.length < blood.length)
+    res.path = path(anyA, anyB, shortest.at);
+  else if (blood.at)
+    res.path = path(upA, upB, blood.at);
+  return res;
+}
+
+// first of the people named by the specifier, as relation chains read it
+static bool first(const std::vector<struct Person*>& people, const struct Person* p) {
+  for (struct Person* q : people) {
+    if (q->firstName_ == p->firstName_)
+      return q == p;
+  }
+  return false;
+}
+
+static std::vector<struct Person*> children(Tree& tree, struct Person* p) {
+  std::vector<struct Person*> res;
+  for (int child : p->children_) {
+    if (struct Person* c = tree.person(child).get())
+      res.push_back(c);
+  }
+  return res;
+}
+
+static std::vector<struct Person*> siblings(Tree& tree, struct Person* p) {
+  std::vector<struct Person*> res;
+  for (int id : { p->father_, p->mother_ }) {
+    std::shared_ptr<struct Person> parent = tree.person(id);
+    if (!parent)
+      continue;
+    for (int child : parent->children_) {
+      struct Person* c = tree.person(child).get();
+      if (c && c != p && std::find(res.begin(), res.end(), c) == res.end())
+        res.push_back(c);
+    }
+  }
+  return res;
+}
+
+static std::vector<struct Person*> spouses(Tree& tree, struct Person* p) {
+  std::vector<struct Person*> res;
+  for (int id : p->children_) {
+    std::shared_ptr<struct Person> child = tree.person(id);
+    if (!child)
+      continue;
+    if (struct Person* other = tree.person(child->father_ == p->id ? child->mother_ : child->father_).get())
+      res.push_back(other);
+  }
+  return res;
+}
+
+std::string chain(Tree& tree, const std::vector<struct Person*>& path, bool* exact) {
+  std::string res;
+  if (exact)
+    *exact = true;
+  for (size_t i = 0; i + 1 < path.size(); i++) {
+    struct Person* p = path[i];
+    struct Person* q = path[i + 1];
+    struct Person* r = i + 2 < path.size() ? path[i + 2] : nullptr;
+    if (!res.empty())
+      res += '.';
+    if (isParent(p, q)) {
+      if (r && isParent(r, q) && first(siblings(tree, p), r)) {
+        res += "sibling:";
+        res += r->firstName_;
+        i++;
+      } else {
+        res += p->father_ == q->id ? "father" : "mother";
+      }
+    } else {
+      if (r && isParent(q, r) && first(spouses(tree, p), r)) {
+        res += "spouse:";
+        res += r->firstName_;
+        i++;
+      } else {
+        res += "child:";
+        res += q->firstName_;
+        // an elder child of the same name is selected instead
+        if (exact && !first(children(tree, p), q))
+          *exact = false;
+      }
+    }
+  }
+  return res;
+}
+
+static std::string ordinal(int n) {
+  static const char* words[] = { "first", "second", "third", "fourth", "fifth", "sixth", "seventh", "eighth", "ninth", "tenth" };
+  if (n <= 10)
+    return words[n - 1];
+  std::string res = std::to_string(n);
+  if (n % 100 >= 11 && n % 100 <= 13)
+    return res + "th";
+  switch (n % 10) {
+  case 1:
+    return res + "st";
+  case 2:
+    return res + "nd";
+  case 3:
+    return res + "rd";
+  default:
+    return res + "th";
+  }
+}
+
+// "great-" for a generation more, then counted
+static std::string greats(int n) {
+  if (n <= 0)
+    return "";
+  if (n <= 2)
+    return n == 1 ? "great-" : "great-great-";
+  return ordinal(n) + " great-";
+}
+
+static std::string removed(int n) {
+  switch (n) {
+  case 0:
+    return "";
+  case 1:
+    return " once removed";
+  case 2:
+    return " twice removed";
+  default:
+    return ' ' + std::to_string(n) + " times removed";
+  }
+}
+
+std::string name(const Kinship& kinship, Sex sex) {
+  bool male = sex == Sex::MALE;
+  int up = kinship.up;
+  int down = kinship.down;
+  if (up < 0) {
+    // parents of a common child
+    if (kinship.path.size() == 3 && isParent(kinship.path[1], kinship.path[0]))
+      return "spouse";
+    return "";
+  }
+  if (!up && !down)
+    return "self";
+  if (!down) {
+    std::string parent = male ? "father" : "mother";
+    return up == 1 ? parent : greats(up - 2) + "grand" + parent;
+  }
+  if (!up) {
+    std::string child = male ? "son" : "daughter";
+    return down == 1 ? child : greats(down - 2) + "grand" + child;
+  }
+  std::string half = kinship.half ? "half-" : "";
+  if (up == 1 && down == 1)
+    return half + (male ? "brother" : "sister");
+  if (up == 1)
+    return half + greats(down - 2) + (male ? "nephew" : "niece");
+  if (down == 1)
+    return half + greats(up - 2) + (male ? "uncle" : "aunt");
+  return (kinship.half ? "half " : "") + ordinal(std::min(up, down) - 1) + " cousin" + removed(std::abs(up - down));
+}
+
+} // namespace kinship
+
+} // namespace genea
@@ -0,0 +1,41 @@
+#pragma once
+
+#include "person.h"
+#include <vector>
+#include <string>
+#include <memory>
+
+namespace genea {
+
+class Tree;
+
+/*
+ * How two people are related
+ * The nearest common ancestors are found by a breadth first search up from
+ * both people at once, and the shortest path through parents and children
+ * by the same search in both directions, each side growing the smaller
+ * frontier. Only the people reached are visited, however large the tree
+ */
+namespace kinship {
+
+struct Kinship {
+  // from a to b, empty if they are not related at all
+  std::vector<struct Person*> path;
+  // generations from a and from b up to the nearest common ancestors, -1 if none
+  int up = -1;
+  int down = -1;
+  // the lines meet at one ancestor, not at a couple
+  bool half = false;
+  std::vector<struct Person*> ancestors;
+};
+
+Kinship relate(Tree& tree, struct Person* a, struct Person* b);
+// the path as a relation chain, which leads to b when selected from a unless
+// exact is set to false: an elder child of the same name comes first
+std::string chain(Tree& tree, const std::vector<struct Person*>& path, bool* exact = nullptr);
+// what b is to a, "" when they are not related by blood
+std::string name(const Kinship& kinship, Sex sex);
+
+} // namespace kinship
+
+} // namespace genea
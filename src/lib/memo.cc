@@ -0,0 +1,60 @@
+#include "memo.h"
+#include "utils.h"
+#include "tree.h"
+
+#include <algorithm>
+
+namespace genea {
+
+std::vector<std::shared_ptr<struct Person>> RelationMemo::find(Tree& tree, std::string_view relations, const std::shared_ptr<struct Person>& start, Status& status) {
+  memory::string key(reinterpret_cast<const char*>(&start->id), sizeof(int));
+  while (relations.size()) {
+    size_t dot = relations.find('.');
+    std::string_view r = relations.substr(0, dot);
+    relations = dot == std::string_view::npos ? std::string_view() : relations.substr(dot + 1);
+    if (r.empty())
+      continue;
+    if (key.size() > sizeof(int))
+      key += '.';
+    key += r;
+  }
+  std::string_view chain = std::string_view(key).substr(sizeof(int));
+
+  auto found = entries_.find(key);
+  if (found != entries_.end()) {
+    const Entry& entry = found->second;
+    const std::vector<std::shared_ptr<struct Person>>& people = *tree.table();
+    bool valid = std::all_of(entry.reads.begin(), entry.reads.end(), [&people](auto& read) {
+      struct Person* p = byId(people, read.first);
+      return p && p->epoch_ == read.second;
+    });
+    if (valid) {
+      hits_++;
+      std::vector<std::shared_ptr<struct Person>> res;
+      for (int id : entry.result)
+        res.push_back(people[id]);
+      return res;
+    }
+    entries_.erase(found);
+  }
+  misses_++;
+
+  std::vector<std::shared_ptr<struct Person>> read;
+  std::vector<std::shared_ptr<struct Person>> res = utils::computeRelation(tree, chain, start, status, &read);
+  if (res.empty())
+    return res;
+  if (entries_.size() >= RELATION_MEMO)
+    entries_.clear();
+  Entry& entry = entries_[key];
+  for (auto& p : read)
+    entry.reads.emplace_back(p->id, p->epoch_);
+  for (auto& p : res)
+    entry.result.push_back(p->id);
+  return res;
+}
+
+void RelationMemo::clear() {
+  entries_.clear();
+}
+
+} // namespace genea
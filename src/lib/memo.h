@@ -0,0 +1,56 @@
+#pragma once
+
+#include "person.h"
+#include "status.h"
+#include <vector>
+#include <string>
+#include <string_view>
+#include <memory>
+
+#ifndef RELATION_MEMO
+  #define RELATION_MEMO (1 << 12)
+#endif
+
+namespace genea {
+
+class Tree;
+
+/*
+ * Results of relation chains by start id and chain, for a tree
+ * An entry keeps the ids of the people its chain read with their epoch, a
+ * person's epoch changes with its links and the names of its children, and
+ * the copy of a person shared with a fork gets its own, so an entry is valid
+ * as long as the people of the tree at these ids have the same epochs. The
+ * memo is emptied once it holds RELATION_MEMO entries, and when ids change
+ */
+class RelationMemo {
+
+public:
+  // computes the chain on a miss, failed chains are not kept
+  std::vector<std::shared_ptr<struct Person>> find(Tree& tree, std::string_view relations, const std::shared_ptr<struct Person>& start, Status& status);
+  void clear();
+
+  size_t size() const {
+    return entries_.size();
+  }
+
+  size_t hits_ = 0;
+  size_t misses_ = 0;
+
+private:
+  struct Hash {
+    size_t operator()(const memory::string& key) const {
+      return std::hash<std::string_view>()(key);
+    }
+  };
+
+  struct Entry {
+    memory::vector<std::pair<int, unsigned long>, memory::CACHES> reads;
+    memory::vector<int, memory::CACHES> result;
+  };
+
+  // start id, then the chain without empty relations
+  memory::unordered_map<memory::string, Entry, memory::CACHES, Hash> entries_;
+};
+
+} // namespace genea
@@ -0,0 +1,51 @@
+#include "memory.h"
+#include "person.h"
+#include "output.h"
+
+#include <cstdio>
+
+namespace genea {
+
+namespace memory {
+
+static const char* names[CATEGORIES] = { "people", "names", "child links", "indexes", "caches", "traversals" };
+
+
+void print(long tables, long tableCount) {
+  std::string out;
+  char buf[128];
+  auto line = [&](const char* name, long bytes, long allocations, long peak) {
+    snprintf(buf, sizeof(buf), "%-16s %14ld %14ld %14ld\n", name, bytes, allocations, peak);
+    out += buf;
+  };
+  // parts of the people records, which are not allocated on their own
+  auto inner = [&](const char* name, long bytes) {
+    snprintf(buf, sizeof(buf), "  %-14s %14ld %14s %14s\n", name, bytes, "-", "-");
+    out += buf;
+  };
+
+  snprintf(buf, sizeof(buf), "%-16s %14s %14s %14s\n", "", "live bytes", "allocations", "peak bytes");
+  out += buf;
+  long bytes = tables;
+  long allocations = tableCount;
+  for (int c = 0; c < CATEGORIES; ++c) {
+    Counter& counter = memory::counter((Category)c);
+    line(names[c], counter.bytes, counter.allocations, counter.peak);
+    bytes += counter.bytes;
+    allocations += counter.allocations;
+    if (c == PEOPLE) {
+      long people = counter.allocations;
+      inner("dates", people * (sizeof(struct Date) + sizeof(std::optional<struct Date>)));
+      inner("parent links", people * 2 * sizeof(std::shared_ptr<struct Person>));
+      snprintf(buf, sizeof(buf), "%-16s %14ld %14ld %14s\n", "people tables", tables, tableCount, "-");
+      out += buf;
+    }
+  }
+  snprintf(buf, sizeof(buf), "%-16s %14ld %14ld\n", "total", bytes, allocations);
+  out += buf;
+  output::write(out);
+}
+
+} // namespace memory
+
+} // namespace genea
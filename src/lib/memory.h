@@ -0,0 +1,95 @@
+#pragma once
+
+#include <atomic>
+#include <memory>
+#include <string>
+#include <vector>
+#include <unordered_map>
+#include <cstddef>
+
+namespace genea {
+
+/*
+ * Memory accounting by category
+ * The structures holding most of the memory allocate through counting
+ * allocators, which keep the live bytes, live allocations and peak bytes of
+ * their category
+ */
+namespace memory {
+
+enum Category {
+  PEOPLE,
+  NAMES,
+  LINKS,
+  INDEXES,
+  CACHES,
+  TRAVERSALS,
+  CATEGORIES
+};
+
+struct Counter {
+  std::atomic<long> bytes = 0;
+  std::atomic<long> allocations = 0;
+  std::atomic<long> peak = 0;
+};
+
+inline Counter& counter(Category category) {
+  static Counter counters[CATEGORIES];
+  return counters[category];
+}
+
+inline void count(Category category, long bytes, long allocations) {
+  Counter& c = counter(category);
+  long live = c.bytes.fetch_add(bytes, std::memory_order_relaxed) + bytes;
+  c.allocations.fetch_add(allocations, std::memory_order_relaxed);
+  long peak = c.peak.load(std::memory_order_relaxed);
+  while (live > peak && !c.peak.compare_exchange_weak(peak, live, std::memory_order_relaxed));
+}
+
+template <typename T, Category C>
+struct Allocator {
+  typedef T value_type;
+
+  template <typename U>
+  struct rebind {
+    typedef Allocator<U, C> other;
+  };
+
+  Allocator() = default;
+  template <typename U>
+  Allocator(const Allocator<U, C>&) {}
+
+  T* allocate(size_t n) {
+    count(C, n * sizeof(T), 1);
+    return std::allocator<T>().allocate(n);
+  }
+
+  void deallocate(T* p, size_t n) {
+    count(C, -(long)(n * sizeof(T)), -1);
+    std::allocator<T>().deallocate(p, n);
+  }
+
+  template <typename U>
+  bool operator==(const Allocator<U, C>&) const { return true; }
+};
+
+typedef std::basic_string<char, std::char_traits<char>, Allocator<char, NAMES>> string;
+
+template <typename T, Category C>
+using vector = std::vector<T, Allocator<T, C>>;
+
+template <typename K, typename V, Category C, typename Hash = std::hash<K>>
+using unordered_map = std::unordered_map<K, V, Hash, std::equal_to<K>, Allocator<std::pair<const K, V>, C>>;
+
+// tables holds the bytes of the people tables, which are not counted
+void print(long tables, long tableCount);
+
+// the object and its control block in one counted allocation
+template <typename T, Category C, typename... Args>
+std::shared_ptr<T> makeShared(Args&&... args) {
+  return std::allocate_shared<T>(Allocator<T, C>(), std::forward<Args>(args)...);
+}
+
+} // namespace memory
+
+} // namespace genea
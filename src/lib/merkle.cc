@@ -0,0 +1,368 @@
+#include "merkle.h"
+#include "utils.h"
+#include "parallel.h"
+
+#include <fstream>
+#include <deque>
+#include <unordered_map>
+#include <charconv>
+
+namespace genea {
+
+namespace merkle {
+
+static const size_t chunkPeople = 1 << 16;
+
+static Hash mix(Hash h) {
+  h ^= h >> 30;
+  h *= 0xbf58476d1ce4e5b9ULL;
+  h ^= h >> 27;
+  h *= 0x94d049bb133111ebULL;
+  return h ^ (h >> 31);
+}
+
+// order matters: father and mother do not commute
+static Hash combine(Hash seed, Hash h) {
+  return mix(seed ^ (h + 0x9e3779b97f4a7c15ULL + (seed << 6) + (seed >> 2)));
+}
+
+static Hash feed(Hash h, std::string_view s) {
+  for (unsigned char c : s)
+    h = (h ^ c) * 0x100000001b3ULL;
+  // never part of UTF-8, so that the fields are kept apart
+  return (h ^ 0xff) * 0x100000001b3ULL;
+}
+
+static Hash feed(Hash h, const struct Date& d) {
+  return combine(combine(combine(h, d.year_), d.month_), d.day_);
+}
+
+static Hash fieldsOf(const struct Person& p) {
+  Hash h = 0xcbf29ce484222325ULL;
+  h = feed(h, p.firstName_);
+  h = feed(h, p.lastName_);
+  h = combine(h, p.sex_ == Sex::MALE ? 'M' : 'F');
+  h = feed(h, p.born_);
+  return p.dead_ ? feed(combine(h, 1), *p.dead_) : combine(h, 0);
+}
+
+// parents before their children, depth first along the parents
+static std::vector<int> ancestorsFirst(const std::vector<std::shared_ptr<struct Person>>& people) {
+  std::vector<int> order;
+  order.reserve(people.size());
+  std::vector<char> state(people.size(), 0);
+  // negative entries leave a person, once all their ancestors are in
+  std::vector<int> stack;
+  for (size_t i = 0; i < people.size(); ++i) {
+    if (state[i])
+      continue;
+    stack.push_back(i);
+    while (!stack.empty()) {
+      int v = stack.back();
+      stack.pop_back();
+      if (v < 0) {
+        state[~v] = 2;
+        order.push_back(~v);
+        continue;
+      }
+      if (state[v])
+        continue;
+      state[v] = 1;
+      stack.push_back(~v);
+      const struct Person& p = *people[v];
+      if (p.mother_ != -1 && !state[p.mother_])
+        stack.push_back(p.mother_);
+      if (p.father_ != -1 && !state[p.father_])
+        stack.push_back(p.father_);
+    }
+  }
+  return order;
+}
+
+Hashes compute(const std::vector<std::shared_ptr<struct Person>>& people) {
+  Hashes res;
+  size_t n = people.size();
+  res.fields.resize(n);
+  res.person.assign(n, 0);
+  res.branch.assign(n, 0);
+  utils::parallelFor((n + chunkPeople - 1) / chunkPeople, [&](size_t c) {
+    for (size_t i = c * chunkPeople; i < std::min(n, (c + 1) * chunkPeople); ++i)
+      res.fields[i] = fieldsOf(*people[i]);
+  });
+  std::vector<int> order = ancestorsFirst(people);
+  for (int v : order) {
+    const struct Person& p = *people[v];
+    res.person[v] = combine(combine(res.fields[v], p.father_ != -1 ? res.person[p.father_] : 0), p.mother_ != -1 ? res.person[p.mother_] : 0);
+  }
+  Hash roots = 0;
+  for (auto v = order.rbegin(); v != order.rend(); ++v) {
+    const struct Person& p = *people[*v];
+    // a sum, so that the order of the children does not count
+    Hash children = 0;
+    for (int child : p.children_)
+      children += mix(res.branch[child]);
+    res.branch[*v] = combine(res.person[*v], children);
+    if (p.father_ == -1 && p.mother_ == -1)
+      roots += mix(res.branch[*v]);
+  }
+  res.tree = combine(roots, n);
+  res.numbered = res.tree;
+  for (size_t i = 0; i < n; ++i)
+    res.numbered = combine(res.numbered, res.person[i]);
+  return res;
+}
+
+std::string format(Hash hash) {
+  char buf[16];
+  std::string res(16, '0');
+  char* end = std::to_chars(buf, buf + sizeof(buf), hash, 16).ptr;
+  std::copy(buf, end, res.end() - (end - buf));
+  return res;
+}
+
+namespace {
+
+typedef std::vector<std::shared_ptr<struct Person>> People;
+
+struct Walk {
+  Walk(const People& a, const Hashes& ha, const People& b, const Hashes& hb):
+  a(a), ha(ha), b(b), hb(hb), pairA(a.size(), -1), pairB(b.size(), -1) {}
+
+  void pair(int x, int y) {
+    pairA[x] = y;
+    pairB[y] = x;
+    pairs.push_back({ x, y });
+    queue.push_back({ x, y });
+  }
+
+  // pairs the people of ca and cb with the same key
+  void pairBy(const std::vector<int>& ca, const std::vector<int>& cb, const memory::vector<Hash, memory::INDEXES>& ka, const memory::vector<Hash, memory::INDEXES>& kb) {
+    if (ca.size() * cb.size() <= 64) {
+      for (int y : cb) {
+        if (pairB[y] >= 0)
+          continue;
+        for (int x : ca) {
+          if (pairA[x] < 0 && ka[x] == kb[y]) {
+            pair(x, y);
+            break;
+          }
+        }
+      }
+      return;
+    }
+    std::unordered_multimap<Hash, int> index;
+    for (int x : ca) {
+      if (pairA[x] < 0)
+        index.emplace(ka[x], x);
+    }
+    for (int y : cb) {
+      if (pairB[y] >= 0)
+        continue;
+      auto found = index.find(kb[y]);
+      if (found == index.end())
+        continue;
+      pair(found->second, y);
+      index.erase(found);
+    }
+  }
+
+  /*
+   * Equal branches are paired first, then the same people with other
+   * descendants, then the same fields with other ancestors. What is left is
+   * paired in order, as people whose fields changed. Under equal branches,
+   * everyone is paired by the first key
+   */
+  void match(const std::vector<int>& ca, const std::vector<int>& cb, bool same) {
+    size_t paired = pairs.size();
+    pairBy(ca, cb, ha.branch, hb.branch);
+    if (!same)
+      skipped += pairs.size() - paired;
+    if (pairs.size() - paired == cb.size())
+      return;
+    pairBy(ca, cb, ha.person, hb.person);
+    pairBy(ca, cb, ha.fields, hb.fields);
+    size_t i = 0;
+    for (int y : cb) {
+      if (pairB[y] >= 0)
+        continue;
+      while (i < ca.size() && pairA[ca[i]] >= 0)
+        i++;
+      if (i == ca.size())
+        break;
+      pair(ca[i++], y);
+    }
+  }
+
+  void run() {
+    std::vector<int> ca, cb;
+    for (size_t x = 0; x < a.size(); ++x) {
+      if (a[x]->father_ == -1 && a[x]->mother_ == -1)
+        ca.push_back(x);
+    }
+    for (size_t y = 0; y < b.size(); ++y) {
+      if (b[y]->father_ == -1 && b[y]->mother_ == -1)
+        cb.push_back(y);
+    }
+    match(ca, cb, false);
+    while (!queue.empty()) {
+      auto [x, y] = queue.front();
+      queue.pop_front();
+      bool same = ha.branch[x] == hb.branch[y];
+      ca.clear();
+      cb.clear();
+      for (int child : a[x]->children_) {
+        if (pairA[child] < 0)
+          ca.push_back(child);
+      }
+      for (int child : b[y]->children_) {
+        if (pairB[child] < 0)
+          cb.push_back(child);
+      }
+      match(ca, cb, same);
+    }
+  }
+
+  const People& a;
+  const Hashes& ha;
+  const People& b;
+  const Hashes& hb;
+  std::vector<int> pairA;
+  std::vector<int> pairB;
+  std::vector<std::pair<int, int>> pairs;
+  std::deque<std::pair<int, int>> queue;
+  size_t skipped = 0;
+};
+
+} // namespace
+
+Patch diff(const People& a, const Hashes& ha, const People& b, const Hashes& hb) {
+  Patch res;
+  res.size = a.size();
+  res.base = ha.numbered;
+  res.target = hb.tree;
+  if (ha.tree == hb.tree)
+    return res;
+  Walk walk(a, ha, b, hb);
+  walk.run();
+  res.skipped = walk.skipped;
+  // the walk reaches everyone but the people on cycles of parents, who are
+  // removed and added again
+  for (size_t x = 0; x < a.size(); ++x) {
+    if (walk.pairA[x] < 0)
+      res.removed.push_back(x);
+  }
+  // ids of the people of b once the patch is applied
+  std::vector<int> ids(b.size(), -1);
+  for (auto [x, y] : walk.pairs)
+    ids[y] = x;
+  for (size_t y = 0; y < b.size(); ++y) {
+    if (walk.pairB[y] < 0) {
+      ids[y] = res.size + res.added.size();
+      res.added.push_back(b[y]);
+    }
+  }
+  auto relink = [&](int id, const struct Person* current, const struct Person& wanted) {
+    int now[2] = { current ? current->father_ : -1, current ? current->mother_ : -1 };
+    int then[2] = { wanted.father_ != -1 ? ids[wanted.father_] : -1, wanted.mother_ != -1 ? ids[wanted.mother_] : -1 };
+    if (now[0] != then[0] || now[1] != then[1])
+      res.links.push_back({ id, then[0], then[1] });
+  };
+  for (auto [x, y] : walk.pairs) {
+    if (ha.fields[x] != hb.fields[y])
+      res.changed.push_back({ x, b[y] });
+    relink(x, a[x].get(), *b[y]);
+  }
+  for (size_t i = 0; i < res.added.size(); ++i)
+    relink(res.size + i, nullptr, *res.added[i]);
+  return res;
+}
+
+Status write(const std::string& file, const Patch& patch) {
+  Status res;
+  std::ofstream out(file);
+  if (!out.good()) {
+    res.error = "Could not write to file " + file;
+    return res;
+  }
+  out << patch.size << ' ' << format(patch.base) << ' ' << format(patch.target) << std::endl;
+  for (int id : patch.removed)
+    out << "- " << id << std::endl;
+  for (auto& [id, p] : patch.changed)
+    out << "~ " << id << ' ' << p->dump() << std::endl;
+  for (auto& p : patch.added)
+    out << "+ " << p->dump() << std::endl;
+  for (auto& link : patch.links)
+    out << "= " << link.id << ' ' << link.father << ' ' << link.mother << std::endl;
+  if (!out.good())
+    res.error = "Could not write to file " + file;
+  return res;
+}
+
+static bool parseHash(std::string_view s, Hash* hash) {
+  auto [end, ec] = std::from_chars(s.data(), s.data() + s.size(), *hash, 16);
+  return ec == std::errc() && end == s.data() + s.size();
+}
+
+static bool parseInt(std::string_view s, int* value) {
+  auto [end, ec] = std::from_chars(s.data(), s.data() + s.size(), *value);
+  return ec == std::errc() && end == s.data() + s.size();
+}
+
+Result<Patch> read(const std::string& file) {
+  Result<Patch> res;
+  std::ifstream in(file);
+  if (!in.good()) {
+    res.error = "Could not open " + file;
+    return res;
+  }
+  Patch& patch = res.value;
+  std::string line;
+  std::vector<std::string_view> args;
+  std::getline(in, line);
+  utils::parseLine(line, ' ', args);
+  int size;
+  if (args.size() != 3 || !parseInt(args[0], &size) || size < 0 || !parseHash(args[1], &patch.base) || !parseHash(args[2], &patch.target)) {
+    res.error = "Patch is invalid or corrupted";
+    return res;
+  }
+  patch.size = size;
+  while (std::getline(in, line)) {
+    args.clear();
+    utils::parseLine(line, ' ', args);
+    if (args.empty())
+      continue;
+    std::string_view op = args[0];
+    bool valid = op.size() == 1;
+    if (valid && op[0] == '-') {
+      int id = 0;
+      valid = args.size() == 2 && parseInt(args[1], &id);
+      patch.removed.push_back(id);
+    } else if (valid && op[0] == '~') {
+      int id = 0;
+      std::string error;
+      std::shared_ptr<struct Person> p;
+      valid = args.size() > 2 && parseInt(args[1], &id) && (p = utils::parsePerson(std::span(args).subspan(2), error));
+      patch.changed.push_back({ id, p });
+    } else if (valid && op[0] == '+') {
+      std::string error;
+      std::shared_ptr<struct Person> p = utils::parsePerson(std::span(args).subspan(1), error);
+      valid = p != nullptr;
+      patch.added.push_back(p);
+    } else if (valid && op[0] == '=') {
+      Patch::Link link = {};
+      valid = args.size() == 4 && parseInt(args[1], &link.id) && parseInt(args[2], &link.father) && parseInt(args[3], &link.mother);
+      patch.links.push_back(link);
+    } else {
+      valid = false;
+    }
+    if (!valid) {
+      res.error = "Patch is invalid or corrupted";
+      return res;
+    }
+  }
+  return res;
+}
+
+} // namespace merkle
+
+} // namespace genea
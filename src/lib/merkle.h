@@ -0,0 +1,81 @@
+#pragma once
+
+#include "person.h"
+#include "status.h"
+#include <vector>
+#include <string>
+#include <memory>
+#include <cstdint>
+
+namespace genea {
+
+/*
+ * Content hashes of a tree, whatever its ids
+ * The hash of a person covers their fields and the hashes of their parents,
+ * so equal hashes mean equal ancestries. The branch of a person covers their
+ * hash and the branches of their children, in any order, and the tree digest
+ * the branches of the people without parents: two trees holding the same
+ * people under other ids have the same digest
+ * A diff walks both trees down from the people without parents, pairing the
+ * children of paired people. Under branches equal on both sides, people are
+ * paired by their branch alone without comparing anything else
+ */
+namespace merkle {
+
+typedef uint64_t Hash;
+
+struct Hashes {
+  // by id
+  memory::vector<Hash, memory::INDEXES> fields;
+  memory::vector<Hash, memory::INDEXES> person;
+  memory::vector<Hash, memory::INDEXES> branch;
+  Hash tree = 0;
+  // the tree digest with the ids, for edits made by id
+  Hash numbered = 0;
+};
+
+// people on a cycle of parents are hashed as if the link closing it was not
+// there, which depends on their ids
+Hashes compute(const std::vector<std::shared_ptr<struct Person>>& people);
+
+std::string format(Hash hash);
+
+/*
+ * Edits turning one tree into another, by ids of the first one. The people
+ * added take the ids following them, in order, and the removals are applied
+ * last so the ids do not shift before
+ */
+struct Patch {
+  struct Link {
+    int id;
+    // -1 for none
+    int father;
+    int mother;
+  };
+
+  size_t size = 0;
+  // the numbered digest of the first tree, the digest of the second
+  Hash base = 0;
+  Hash target = 0;
+  std::vector<int> removed;
+  // the new fields of a person
+  std::vector<std::pair<int, std::shared_ptr<struct Person>>> changed;
+  std::vector<std::shared_ptr<struct Person>> added;
+  std::vector<Link> links;
+  bool empty() const {
+    return removed.empty() && changed.empty() && added.empty() && links.empty();
+  }
+
+  // branches found equal on both sides, where nothing else was compared
+  size_t skipped = 0;
+};
+
+// the people of changed and added are those of b, with their ids in b
+Patch diff(const std::vector<std::shared_ptr<struct Person>>& a, const Hashes& ha, const std::vector<std::shared_ptr<struct Person>>& b, const Hashes& hb);
+
+Status write(const std::string& file, const Patch& patch);
+Result<Patch> read(const std::string& file);
+
+} // namespace merkle
+
+} // namespace genea
@@ -0,0 +1,152 @@
+#include "output.h"
+#include "parallel.h"
+
+#include <iostream>
+#include <thread>
+#include <cerrno>
+#include <unistd.h>
+
+namespace genea {
+
+namespace output {
+
+static const size_t chunkPeople = 4096;
+
+
+bool parseFormat(std::string_view name, Format* format) {
+  if (name == "text")
+    *format = Format::TEXT;
+  else if (name == "tsv")
+    *format = Format::TSV;
+  else if (name == "json")
+    *format = Format::JSON;
+  else
+    return false;
+  return true;
+}
+
+static void jsonString(std::string& out, std::string_view s) {
+  static const char hex[] = "0123456789abcdef";
+  out += '"';
+  for (char c : s) {
+    if (c == '"' || c == '\\') {
+      out += '\\';
+      out += c;
+    } else if ((unsigned char)c < 0x20) {
+      out += "\\u00";
+      out += hex[(c >> 4) & 0xf];
+      out += hex[c & 0xf];
+    } else {
+      out += c;
+    }
+  }
+  out += '"';
+}
+
+static void jsonDate(std::string& out, const struct Date& d) {
+  out += '"';
+  d.format(out);
+  out += '"';
+}
+
+void format(std::string& out, const struct Person& p, Format format) {
+  switch (format) {
+  case Format::TEXT:
+    p.text(out);
+    return;
+  case Format::TSV:
+    Date::append(out, p.id);
+    out += '\t';
+    out += p.firstName_;
+    out += '\t';
+    out += p.lastName_;
+    out += (p.sex_ == Sex::MALE ? "\tM\t" : "\tF\t");
+    p.born_.format(out);
+    out += '\t';
+    if (p.dead_)
+      p.dead_->format(out);
+    out += '\t';
+    Date::append(out, p.father_);
+    out += '\t';
+    Date::append(out, p.mother_);
+    out += '\n';
+    return;
+  case Format::JSON:
+    out += "{\"id\":";
+    Date::append(out, p.id);
+    out += ",\"first\":";
+    jsonString(out, p.firstName_);
+    out += ",\"last\":";
+    jsonString(out, p.lastName_);
+    out += (p.sex_ == Sex::MALE ? ",\"sex\":\"M\",\"birth\":" : ",\"sex\":\"F\",\"birth\":");
+    jsonDate(out, p.born_);
+    out += ",\"death\":";
+    if (p.dead_)
+      jsonDate(out, *p.dead_);
+    else
+      out += "null";
+    out += ",\"father\":";
+    if (p.father_ != -1)
+      Date::append(out, p.father_);
+    else
+      out += "null";
+    out += ",\"mother\":";
+    if (p.mother_ != -1)
+      Date::append(out, p.mother_);
+    else
+      out += "null";
+    out += "}\n";
+    return;
+  }
+}
+
+void write(std::string_view data) {
+  std::cout.flush();
+  while (data.size()) {
+    ssize_t w = ::write(STDOUT_FILENO, data.data(), data.size());
+    if (w < 0 && errno == EINTR)
+      continue;
+    if (w <= 0)
+      return;
+    data.remove_prefix(w);
+  }
+}
+
+void render(std::span<const std::shared_ptr<struct Person>> people, Format format) {
+  std::string header = format == Format::TSV ? "id\tfirst\tlast\tsex\tbirth\tdeath\tfather\tmother\n" : "";
+  if (people.size() <= chunkPeople) {
+    for (auto& p : people)
+      output::format(header, *p, format);
+    write(header);
+    return;
+  }
+  write(header);
+
+  // a window is formatted while the previous one is written
+  size_t window = chunkPeople * utils::workers() * 2;
+  std::vector<std::string> buffers[2];
+  std::thread writer;
+  int current = 0;
+  for (size_t start = 0; start < people.size(); start += window, current ^= 1) {
+    std::span<const std::shared_ptr<struct Person>> slice = people.subspan(start, std::min(window, people.size() - start));
+    std::vector<std::string>& chunks = buffers[current];
+    chunks.resize((slice.size() + chunkPeople - 1) / chunkPeople);
+    utils::parallelFor(chunks.size(), [&](size_t c) {
+      chunks[c].clear();
+      for (size_t i = c * chunkPeople; i < std::min(slice.size(), (c + 1) * chunkPeople); ++i)
+        output::format(chunks[c], *slice[i], format);
+    });
+    if (writer.joinable())
+      writer.join();
+    writer = std::thread([&chunks]() {
+      for (auto& chunk : chunks)
+        write(chunk);
+    });
+  }
+  if (writer.joinable())
+    writer.join();
+}
+
+} // namespace output
+
+} // namespace genea
@@ -0,0 +1,32 @@
+#pragma once
+
+#include "person.h"
+#include <vector>
+#include <string>
+#include <string_view>
+#include <span>
+#include <memory>
+
+namespace genea {
+
+enum class Format {
+  TEXT,
+  TSV,
+  JSON
+};
+
+/*
+ * Bulk output of people
+ * People are formatted by chunks on all cores, chunks are written in order to
+ * stdout with large writes while the next ones are formatted
+ */
+namespace output {
+
+bool parseFormat(std::string_view name, Format* format);
+void format(std::string& out, const struct Person& p, Format format);
+void render(std::span<const std::shared_ptr<struct Person>> people, Format format);
+void write(std::string_view data);
+
+} // namespace output
+
+} // namespace genea
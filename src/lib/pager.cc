@@ -0,0 +1,155 @@
+#include "pager.h"
+#include "utils.h"
+
+#include <iostream>
+#include <cstring>
+#include <charconv>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+namespace genea {
+
+Pager::Pager(std::vector<std::shared_ptr<struct Person>>& people, size_t capacity):
+people_(people),
+capacity_(capacity),
+data_(nullptr),
+size_(0) {}
+
+Pager::~Pager() {
+  if (data_)
+    munmap((void*)data_, size_);
+}
+
+static const char* nextLine(const char* cur, const char* end) {
+  const char* eol = (const char*)memchr(cur, '\n', end - cur);
+  return eol ? eol + 1 : end;
+}
+
+static const char* parseInt(const char* cur, const char* end, int* value) {
+  while (cur < end && *cur == ' ')
+    cur++;
+  auto res = std::from_chars(cur, end, *value);
+  return res.ec == std::errc() ? res.ptr : nullptr;
+}
+
+bool Pager::open(const std::string& file) {
+  int fd = ::open(file.c_str(), O_RDONLY);
+  if (fd < 0)
+    return false;
+  struct stat st;
+  if (fstat(fd, &st) || !st.st_size) {
+    close(fd);
+    return false;
+  }
+  void* map = mmap(nullptr, st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+  close(fd);
+  if (map == MAP_FAILED)
+    return false;
+  data_ = (const char*)map;
+  size_ = st.st_size;
+  madvise(map, size_, MADV_SEQUENTIAL);
+
+  const char* end = data_ + size_;
+  int n;
+  const char* cur = parseInt(data_, end, &n);
+  if (!cur || n <= 0)
+    return false;
+  cur = nextLine(cur, end);
+
+  // first pass: record offsets and parent ids, nothing is built
+  records_.reserve(n);
+  for (int i = 0; i < n; ++i) {
+    if (cur >= end)
+      return false;
+    records_.push_back(cur - data_);
+    cur = nextLine(cur, end);
+  }
+  fathers_.resize(n);
+  mothers_.resize(n);
+  for (int i = 0; i < n; ++i) {
+    const char* next = cur < end ? parseInt(cur, end, &fathers_[i]) : nullptr;
+    next = next ? parseInt(next, end, &mothers_[i]) : nullptr;
+    if (!next)
+      return false;
+    cur = nextLine(next, end);
+  }
+
+  // children lists, in the same order as a full load
+  childStart_.assign(n + 1, 0);
+  for (int i = 0; i < n; ++i) {
+    if (fathers_[i] >= 0 && fathers_[i] < n)
+      childStart_[fathers_[i] + 1]++;
+    if (mothers_[i] >= 0 && mothers_[i] < n)
+      childStart_[mothers_[i] + 1]++;
+  }
+  for (int i = 0; i < n; ++i)
+    childStart_[i + 1] += childStart_[i];
+  childIds_.resize(childStart_[n]);
+  std::vector<int> fill(childStart_.begin(), childStart_.end() - 1);
+  for (int i = 0; i < n; ++i) {
+    if (fathers_[i] >= 0 && fathers_[i] < n)
+      childIds_[fill[fathers_[i]]++] = i;
+    if (mothers_[i] >= 0 && mothers_[i] < n)
+      childIds_[fill[mothers_[i]]++] = i;
+  }
+
+  madvise(map, size_, MADV_RANDOM);
+  people_.resize(n);
+  return true;
+}
+
+std::shared_ptr<struct Person> Pager::get(int id) {
+  std::shared_ptr<struct Person>& slot = people_[id];
+  if (slot)
+    return slot;
+  const char* begin = data_ + records_[id];
+  const char* end = nextLine(begin, data_ + size_);
+  std::string line(begin, end);
+  if (line.size() && line.back() == '\n')
+    line.pop_back();
+  std::string error;
+  slot = utils::parsePerson(utils::parseLine(line, ' '), error);
+  if (!slot) {
+    corrupted_.push_back(id);
+    slot = memory::makeShared<struct Person, memory::PEOPLE>("?", "?", Sex::MALE, Date());
+  }
+  int n = records_.size();
+  slot->id = id;
+  if (fathers_[id] >= 0 && fathers_[id] < n)
+    slot->father_ = fathers_[id];
+  if (mothers_[id] >= 0 && mothers_[id] < n)
+    slot->mother_ = mothers_[id];
+  slot->children_.assign(childIds_.begin() + childStart_[id], childIds_.begin() + childStart_[id + 1]);
+  resident_.push_back(id);
+  return slot;
+}
+
+void Pager::evict() {
+  if (resident_.size() <= capacity_)
+    return;
+  // oldest first, people held elsewhere or modified stay
+  size_t excess = resident_.size() - capacity_;
+  size_t kept = 0;
+  for (int id : resident_) {
+    std::shared_ptr<struct Person>& p = people_[id];
+    if (!p)
+      continue;
+    if (excess && p.use_count() == 1 && !p->dirty_) {
+      p = nullptr;
+      excess--;
+      continue;
+    }
+    resident_[kept++] = id;
+  }
+  resident_.resize(kept);
+}
+
+void Pager::loadAll() {
+  for (int i = 0; i < (int)records_.size(); ++i)
+    get(i);
+  resident_.clear();
+}
+
+} // namespace genea
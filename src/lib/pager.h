@@ -0,0 +1,53 @@
+#pragma once
+
+#include "person.h"
+#include <vector>
+#include <string>
+#include <memory>
+
+#ifndef RESIDENT_PEOPLE
+  #define RESIDENT_PEOPLE 1000000
+#endif
+
+namespace genea {
+
+/*
+ * Lazy view over a dumped tree
+ * The file is mapped and indexed in one pass (record offsets and parent ids),
+ * people are only built when reached, with the ids of their parents and
+ * children. Once more than `capacity` people are read, the oldest ones held
+ * by nothing else and unmodified are dropped
+ */
+class Pager {
+
+public:
+  Pager(std::vector<std::shared_ptr<struct Person>>& people, size_t capacity = RESIDENT_PEOPLE);
+  ~Pager();
+
+  bool open(const std::string& file);
+  std::shared_ptr<struct Person> get(int id);
+  void evict();
+  void loadAll();
+
+  // records read since this was last emptied that could not be parsed, their
+  // people are left unknown
+  std::vector<int> corrupted_;
+
+private:
+  std::vector<std::shared_ptr<struct Person>>& people_;
+  size_t capacity_;
+
+  const char* data_;
+  size_t size_;
+
+  memory::vector<size_t, memory::INDEXES> records_;
+  memory::vector<int, memory::INDEXES> fathers_;
+  memory::vector<int, memory::INDEXES> mothers_;
+  memory::vector<int, memory::INDEXES> childStart_;
+  memory::vector<int, memory::INDEXES> childIds_;
+
+  // ids of the people read, oldest first
+  memory::vector<int, memory::CACHES> resident_;
+};
+
+} // namespace genea
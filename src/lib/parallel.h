@@ -0,0 +1,47 @@
+#pragma once
+
+#include <thread>
+#include <atomic>
+#include <vector>
+#include <algorithm>
+
+namespace genea {
+
+namespace utils {
+
+inline unsigned workers() {
+  return std::max(1u, std::thread::hardware_concurrency());
+}
+
+// set on the threads of a parallelFor
+inline thread_local bool nested = false;
+
+/*
+ * Runs fn(0) ... fn(count - 1) over all cores, tasks are handed out one at a time
+ * so uneven tasks keep every thread busy. Within a task, it runs serially as
+ * every core is busy already
+ */
+template <typename F>
+void parallelFor(size_t count, F fn) {
+  unsigned n = std::min<size_t>(workers(), count);
+  if (n <= 1 || nested) {
+    for (size_t i = 0; i < count; ++i)
+      fn(i);
+    return;
+  }
+  std::atomic<size_t> next = 0;
+  std::vector<std::thread> threads;
+  for (unsigned t = 0; t < n; ++t) {
+    threads.emplace_back([&]() {
+      nested = true;
+      for (size_t i = next++; i < count; i = next++)
+        fn(i);
+    });
+  }
+  for (auto& thread : threads)
+    thread.join();
+}
+
+} // namespace utils
+
+} // namespace genea
@@ -0,0 +1,142 @@
+#pragma once
+
+#include <string>
+#include <string_view>
+#include <optional>
+#include <memory>
+#include <vector>
+#include <iostream>
+#include <charconv>
+#include <atomic>
+#include "memory.h"
+
+namespace genea {
+
+enum class Sex {
+  MALE,
+  FEMALE
+};
+
+struct Date {
+
+  Date(): year_(-1), month_(-1), day_(-1) {};
+  Date(int year): year_(year), month_(-1), day_(-1) {};
+  Date(int year, int month): year_(year), month_(month), day_(-1) {};
+  Date(int year, int month, int day) : year_(year), month_(month), day_(day) {};
+
+  std::string toString() const {
+    std::string res;
+    format(res);
+    return res;
+  }
+
+  void format(std::string& out) const {
+    if (year_ == -1) {
+      out += '?';
+      return;
+    }
+    if (day_ != -1) {
+      append(out, day_);
+      out += '/';
+    }
+    if (month_ != -1) {
+      append(out, month_);
+      out += '/';
+    }
+    append(out, year_);
+  }
+
+  static void append(std::string& out, int value) {
+    char buf[16];
+    out.append(buf, std::to_chars(buf, buf + sizeof(buf), value).ptr);
+  }
+
+  int year_;
+  int month_;
+  int day_;
+};
+
+struct Person {
+
+public:
+  Person() {}
+
+  Person(std::string_view firstName, std::string_view lastName, Sex sex, struct Date born):
+  firstName_(firstName), lastName_(lastName), sex_(sex), born_(born), dead_({}), children_({}), id(-1) {};
+
+  Person(std::string_view firstName, std::string_view lastName, Sex sex, struct Date born, struct Date dead):
+  firstName_(firstName), lastName_(lastName), sex_(sex), born_(born), dead_(dead), children_({}), id(-1) {};
+
+  void info(int space = 1) {
+    std::string out;
+    text(out, space);
+    std::cout << out;
+  }
+
+  void text(std::string& out, int space = 1) const {
+    out += "Person ID ";
+    Date::append(out, id);
+    out += '\n';
+    out.append(space, ' ');
+    out += (sex_ == Sex::MALE ? "(M) " : "(F) ");
+    out += firstName_;
+    out += ' ';
+    out += lastName_;
+    out += '\n';
+    out.append(space, ' ');
+    born_.format(out);
+    out += " - ";
+    if (dead_)
+      dead_->format(out);
+    out += '\n';
+  }
+
+  std::string dotId() {
+    return "n" + std::to_string(id);
+  }
+
+  std::string dot() {
+    std::string name = dotId();
+    std::string color = sex_ == Sex::MALE ? "lightblue" : "pink";
+    std::string label = "<B>" + std::string(firstName_) + ' ' + std::string(lastName_) + "</B><br/>" + born_.toString() + " - " + (dead_ ? dead_->toString() : "");
+    return name + " [shape=box, style=filled, color=" + color + ", label=< " + label + " >]";
+  }
+
+  std::string dump() {
+    return std::string(firstName_) + ' ' + std::string(lastName_) + ' ' + (sex_ == Sex::MALE ? 'M' : 'F') + ' ' + born_.toString() + ' ' + (dead_ ? dead_->toString() : "");
+  }
+
+  // any change to the person, its links or the names of its children, epochs
+  // are unique among people
+  void touch() {
+    static std::atomic<unsigned long> epochs = 0;
+    dirty_ = true;
+    epoch_ = ++epochs;
+  }
+
+  memory::string firstName_;
+  memory::string lastName_;
+  Sex sex_;
+  struct Date born_;
+  std::optional<struct Date> dead_;
+
+  // by id, read through the tree of the person, -1 for none
+  int mother_ = -1;
+  int father_ = -1;
+
+  memory::vector<int, memory::LINKS> children_;
+
+  int id;
+
+  // the tree changing the person in place, other trees copy it first
+  unsigned long owner_ = 0;
+  bool dirty_ = false;
+  unsigned long epoch_ = 0;
+};
+
+// the person of an id among people, nullptr for -1 or an id outside of them
+inline struct Person* byId(const std::vector<std::shared_ptr<struct Person>>& people, int id) {
+  return id >= 0 && (size_t)id < people.size() ? people[id].get() : nullptr;
+}
+
+} // namespace genea
\ No newline at end of file
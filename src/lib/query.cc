@@ -0,0 +1,408 @@
+#include "query.h"
+#include "tree.h"
+#include "utils.h"
+#include "parallel.h"
+
+#include <algorithm>
+#include <charconv>
+#include <climits>
+
+namespace genea {
+
+static const size_t chunkPeople = 1 << 14;
+
+
+static char fold(char c) {
+  return (c >= 'A' && c <= 'Z') ? c + ('a' - 'A') : c;
+}
+
+static bool containsFolded(std::string_view s, std::string_view folded) {
+  if (folded.size() > s.size())
+    return false;
+  for (size_t i = 0; i + folded.size() <= s.size(); ++i) {
+    size_t j = 0;
+    while (j < folded.size() && fold(s[i + j]) == folded[j])
+      j++;
+    if (j == folded.size())
+      return true;
+  }
+  return false;
+}
+
+static bool compare(int value, Predicate::Op op, int number) {
+  switch (op) {
+  case Predicate::EQ: return value == number;
+  case Predicate::NE: return value != number;
+  case Predicate::LT: return value < number;
+  case Predicate::LE: return value <= number;
+  case Predicate::GT: return value > number;
+  case Predicate::GE: return value >= number;
+  default: return false;
+  }
+}
+
+static bool compare(std::string_view value, Predicate::Op op, const std::string& text) {
+  if (op == Predicate::CONTAINS)
+    return containsFolded(value, text);
+  return (value == text) == (op == Predicate::EQ);
+}
+
+bool Predicate::match(const std::vector<std::shared_ptr<struct Person>>& people, const struct Person& p) const {
+  bool res = false;
+  switch (field) {
+  case FIRST:
+    res = compare(p.firstName_, op, text);
+    break;
+  case LAST:
+    res = compare(p.lastName_, op, text);
+    break;
+  case NAME:
+    res = op == NE
+      ? std::string_view(p.firstName_) != text && std::string_view(p.lastName_) != text
+      : compare(p.firstName_, op, text) || compare(p.lastName_, op, text);
+    break;
+  case SEX:
+    res = ((int)p.sex_ == number) == (op == EQ);
+    break;
+  case BORN:
+    res = p.born_.year_ != -1 && compare(p.born_.year_, op, number);
+    break;
+  case DIED:
+    res = p.dead_ && p.dead_->year_ != -1 && compare(p.dead_->year_, op, number);
+    break;
+  case HAS:
+    if (text == "father") {
+      res = p.father_ != -1;
+    } else if (text == "mother") {
+      res = p.mother_ != -1;
+    } else if (text == "children") {
+      res = !p.children_.empty();
+    } else if (text == "spouse") {
+      for (int child : p.children_) {
+        const struct Person* c = byId(people, child);
+        res = res || (c && c->father_ != -1 && c->mother_ != -1);
+      }
+    } else if (text == "birth") {
+      res = p.born_.year_ != -1;
+    } else {
+      res = p.dead_.has_value();
+    }
+    break;
+  case IN:
+    res = p.id >= 0 && (size_t)p.id < members.size() && members[p.id];
+    break;
+  }
+  return res != negate;
+}
+
+bool Query::parse(std::span<const std::string_view> args, std::string& error) {
+  static const std::pair<std::string_view, Predicate::Field> fields[] = {
+    { "first", Predicate::FIRST }, { "last", Predicate::LAST }, { "name", Predicate::NAME }, { "sex", Predicate::SEX },
+    { "born", Predicate::BORN }, { "died", Predicate::DIED }, { "has", Predicate::HAS }, { "in", Predicate::IN }
+  };
+  static const std::pair<std::string_view, Predicate::Op> ops[] = {
+    { "<=", Predicate::LE }, { ">=", Predicate::GE }, { "!=", Predicate::NE },
+    { "<", Predicate::LT }, { ">", Predicate::GT }, { "=", Predicate::EQ }, { "~", Predicate::CONTAINS }
+  };
+  bool negate = false;
+  for (std::string_view arg : args) {
+    if (arg == "not") {
+      negate = !negate;
+      continue;
+    }
+    size_t pos = arg.find_first_of("<>=!~");
+    if (pos == std::string_view::npos || pos == 0) {
+      error = "Malformed term " + std::string(arg);
+      return false;
+    }
+    std::string_view key = arg.substr(0, pos);
+    std::string_view rest = arg.substr(pos);
+    const Predicate::Op* op = nullptr;
+    for (auto& o : ops) {
+      if (rest.starts_with(o.first)) {
+        op = &o.second;
+        rest.remove_prefix(o.first.size());
+        break;
+      }
+    }
+    if (!op || rest.empty()) {
+      error = "Malformed term " + std::string(arg);
+      return false;
+    }
+
+    if (key == "sort" || key == "limit") {
+      if (*op != Predicate::EQ || negate) {
+        error = "Malformed term " + std::string(arg);
+        return false;
+      }
+      if (key == "limit") {
+        auto [ptr, ec] = std::from_chars(rest.data(), rest.data() + rest.size(), limit_);
+        if (ec != std::errc() || ptr != rest.data() + rest.size()) {
+          error = "Limit must be a number";
+          return false;
+        }
+        continue;
+      }
+      descending_ = rest.starts_with('-');
+      if (descending_)
+        rest.remove_prefix(1);
+      if (rest != "id" && rest != "first" && rest != "last" && rest != "born" && rest != "died") {
+        error = "Can only sort by id, first, last, born or died";
+        return false;
+      }
+      sort_ = rest;
+      continue;
+    }
+
+    const Predicate::Field* field = nullptr;
+    for (auto& f : fields) {
+      if (key == f.first)
+        field = &f.second;
+    }
+    if (!field) {
+      error = "Unknown field " + std::string(key);
+      return false;
+    }
+    Predicate p;
+    p.field = *field;
+    p.op = *op;
+    p.negate = negate;
+    p.text = rest;
+    negate = false;
+    bool name = p.field == Predicate::FIRST || p.field == Predicate::LAST || p.field == Predicate::NAME;
+    bool year = p.field == Predicate::BORN || p.field == Predicate::DIED;
+    if (!year && !name && p.op != Predicate::EQ && !(p.field == Predicate::SEX && p.op == Predicate::NE)) {
+      error = "Unsupported operator in " + std::string(arg);
+      return false;
+    }
+    if (name && p.op != Predicate::EQ && p.op != Predicate::NE && p.op != Predicate::CONTAINS) {
+      error = "Unsupported operator in " + std::string(arg);
+      return false;
+    }
+    if (year && p.op == Predicate::CONTAINS) {
+      error = "Unsupported operator in " + std::string(arg);
+      return false;
+    }
+    if (p.op == Predicate::CONTAINS) {
+      for (char& c : p.text)
+        c = fold(c);
+    }
+    if (year) {
+      auto [ptr, ec] = std::from_chars(rest.data(), rest.data() + rest.size(), p.number);
+      if (ec != std::errc() || ptr != rest.data() + rest.size()) {
+        error = "Year must be a number in " + std::string(arg);
+        return false;
+      }
+    }
+    if (p.field == Predicate::SEX) {
+      if (rest != "M" && rest != "F") {
+        error = "Sex must be either M or F";
+        return false;
+      }
+      p.number = (int)(rest == "M" ? Sex::MALE : Sex::FEMALE);
+    }
+    if (p.field == Predicate::HAS && rest != "father" && rest != "mother" && rest != "children"
+        && rest != "spouse" && rest != "birth" && rest != "death") {
+      error = "Can only test father, mother, children, spouse, birth or death";
+      return false;
+    }
+    predicates_.push_back(std::move(p));
+  }
+  if (negate) {
+    error = "Dangling not";
+    return false;
+  }
+  return true;
+}
+
+bool Query::bind(Tree& tree, std::shared_ptr<struct Person> cursor, std::string& error) {
+  for (auto& p : predicates_) {
+    if (p.field != Predicate::IN)
+      continue;
+    if (!cursor) {
+      error = "Relation terms need a cursor";
+      return false;
+    }
+    p.members.assign(tree.size(), false);
+    if (p.text == "ancestors" || p.text == "descendants") {
+      bool up = p.text == "ancestors";
+      std::vector<std::shared_ptr<struct Person>> stack = { cursor };
+      while (stack.size()) {
+        std::shared_ptr<struct Person> cur = stack.back();
+        stack.pop_back();
+        std::vector<int> next;
+        if (up)
+          next = { cur->father_, cur->mother_ };
+        else
+          next.assign(cur->children_.begin(), cur->children_.end());
+        for (int id : next) {
+          std::shared_ptr<struct Person> n = tree.person(id);
+          if (n && !p.members[id]) {
+            p.members[id] = true;
+            p.ids.push_back(id);
+            stack.push_back(n);
+          }
+        }
+      }
+    } else {
+      Status status;
+      for (auto& person : utils::computeRelation(tree, p.text, cursor, status)) {
+        if (!p.members[person->id]) {
+          p.members[person->id] = true;
+          p.ids.push_back(person->id);
+        }
+      }
+      if (!status) {
+        error = status.error;
+        return false;
+      }
+    }
+    std::sort(p.ids.begin(), p.ids.end());
+  }
+  return true;
+}
+
+void FindIndex::build(const std::vector<std::shared_ptr<struct Person>>& people) {
+  first_.clear();
+  last_.clear();
+  born_.clear();
+  for (auto& p : people) {
+    first_[p->firstName_].push_back(p->id);
+    last_[p->lastName_].push_back(p->id);
+    if (p->born_.year_ != -1)
+      born_.emplace_back(p->born_.year_, p->id);
+  }
+  std::sort(born_.begin(), born_.end());
+}
+
+static std::span<const int> lookup(const FindIndex::Names& index, const std::string& name) {
+  auto it = index.find(name);
+  if (it == index.end())
+    return {};
+  return it->second;
+}
+
+std::vector<int> FindIndex::run(const Query& query, const std::vector<std::shared_ptr<struct Person>>& people, const NameIndex& names, std::string& plan) const {
+  size_t n = people.size();
+  // a pass over the folded names costs a fraction of checking every person
+  size_t cost = n;
+  const Predicate* driver = nullptr;
+  std::pair<int, int> from = { INT_MIN, INT_MIN };
+  std::pair<int, int> to = { INT_MAX, INT_MAX };
+  for (auto& p : query.predicates_) {
+    if (p.negate)
+      continue;
+    size_t estimate = -1;
+    if ((p.field == Predicate::FIRST || p.field == Predicate::LAST) && p.op == Predicate::EQ) {
+      estimate = lookup(p.field == Predicate::FIRST ? first_ : last_, p.text).size();
+    } else if (p.field == Predicate::NAME && p.op == Predicate::EQ) {
+      estimate = lookup(first_, p.text).size() + lookup(last_, p.text).size();
+    } else if (p.op == Predicate::CONTAINS) {
+      estimate = n / 4;
+    } else if (p.field == Predicate::BORN && p.op != Predicate::NE) {
+      std::pair<int, int> lo = { INT_MIN, INT_MIN };
+      std::pair<int, int> hi = { INT_MAX, INT_MAX };
+      if (p.op == Predicate::EQ || p.op == Predicate::GE)
+        lo = { p.number, INT_MIN };
+      if (p.op == Predicate::GT)
+        lo = { p.number, INT_MAX };
+      if (p.op == Predicate::EQ || p.op == Predicate::LE)
+        hi = { p.number, INT_MAX };
+      if (p.op == Predicate::LT)
+        hi = { p.number, INT_MIN };
+      auto first = std::lower_bound(born_.begin(), born_.end(), lo);
+      estimate = std::max(first, std::lower_bound(born_.begin(), born_.end(), hi)) - first;
+      if (estimate < cost) {
+        from = lo;
+        to = hi;
+      }
+    } else if (p.field == Predicate::IN) {
+      estimate = p.ids.size();
+    }
+    if (estimate < cost) {
+      cost = estimate;
+      driver = &p;
+    }
+  }
+
+  std::vector<int> candidates;
+  if (!driver) {
+    plan = "full scan of " + std::to_string(n) + " people";
+  } else {
+    switch (driver->field) {
+    case Predicate::BORN: {
+      auto lo = std::lower_bound(born_.begin(), born_.end(), from);
+      auto hi = std::max(lo, std::lower_bound(born_.begin(), born_.end(), to));
+      for (auto it = lo; it != hi; ++it)
+        candidates.push_back(it->second);
+      plan = "birth index";
+      break;
+    }
+    case Predicate::IN:
+      candidates = driver->ids;
+      plan = "relation " + driver->text;
+      break;
+    default:
+      if (driver->op == Predicate::CONTAINS) {
+        candidates = names.find(people, driver->text, true, true);
+        plan = "name scan";
+      } else {
+        if (driver->field != Predicate::LAST)
+          for (int id : lookup(first_, driver->text))
+            candidates.push_back(id);
+        if (driver->field != Predicate::FIRST)
+          for (int id : lookup(last_, driver->text))
+            candidates.push_back(id);
+        plan = "name index";
+      }
+      break;
+    }
+    std::sort(candidates.begin(), candidates.end());
+    candidates.erase(std::unique(candidates.begin(), candidates.end()), candidates.end());
+    plan += " (term " + std::to_string(driver - query.predicates_.data() + 1) + "), " + std::to_string(candidates.size()) + " candidates";
+  }
+
+  size_t total = driver ? candidates.size() : n;
+  std::vector<std::vector<int>> found((total + chunkPeople - 1) / chunkPeople);
+  utils::parallelFor(found.size(), [&](size_t c) {
+    for (size_t i = c * chunkPeople; i < std::min(total, (c + 1) * chunkPeople); ++i) {
+      int id = driver ? candidates[i] : i;
+      const struct Person& p = *people[id];
+      if (std::all_of(query.predicates_.begin(), query.predicates_.end(), [&](const Predicate& term) { return term.match(people, p); }))
+        found[c].push_back(id);
+    }
+  });
+  std::vector<int> res;
+  for (auto& ids : found)
+    res.insert(res.end(), ids.begin(), ids.end());
+
+  if (query.sort_ != "id" || query.descending_) {
+    // unknown values sort last in both directions
+    auto key = [&](int id) -> std::tuple<bool, int, int, int> {
+      const struct Person& p = *people[id];
+      const struct Date* d = query.sort_ == "born" ? &p.born_ : query.sort_ == "died" && p.dead_ ? &*p.dead_ : nullptr;
+      if (!d || d->year_ == -1)
+        return { true, 0, 0, 0 };
+      return { false, d->year_, d->month_, d->day_ };
+    };
+    std::stable_sort(res.begin(), res.end(), [&](int a, int b) {
+      if (query.sort_ == "first" || query.sort_ == "last") {
+        std::string_view x = query.sort_ == "first" ? people[a]->firstName_ : people[a]->lastName_;
+        std::string_view y = query.sort_ == "first" ? people[b]->firstName_ : people[b]->lastName_;
+        return query.descending_ ? y < x : x < y;
+      }
+      if (query.sort_ == "id")
+        return query.descending_ ? b < a : a < b;
+      auto x = key(a);
+      auto y = key(b);
+      if (std::get<0>(x) != std::get<0>(y))
+        return std::get<0>(y);
+      return query.descending_ ? y < x : x < y;
+    });
+  }
+  if (res.size() > query.limit_)
+    res.resize(query.limit_);
+  return res;
+}
+
+} // namespace genea
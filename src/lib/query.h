@@ -0,0 +1,74 @@
+#pragma once
+
+#include "person.h"
+#include "scan.h"
+#include <vector>
+#include <string>
+#include <string_view>
+#include <span>
+#include <memory>
+#include <unordered_map>
+
+namespace genea {
+
+class Tree;
+
+/*
+ * One term of a find query: <field><op><value>, optionally preceded by "not"
+ *   first, last, name (either)   =, !=, ~ (contains, ignoring case)
+ *   sex                          =, !=
+ *   born, died (years)           =, !=, <, <=, >, >=
+ *   has                          = father, mother, children, spouse, birth, death
+ *   in                           = <relation>, ancestors, descendants (of the cursor)
+ */
+struct Predicate {
+  enum Field { FIRST, LAST, NAME, SEX, BORN, DIED, HAS, IN };
+  enum Op { EQ, NE, LT, LE, GT, GE, CONTAINS };
+
+  // p among people, whose links it reads
+  bool match(const std::vector<std::shared_ptr<struct Person>>& people, const struct Person& p) const;
+
+  Field field;
+  Op op;
+  bool negate = false;
+  std::string text;
+  int number = 0;
+  // people of an "in" term, by id
+  std::vector<int> ids;
+  std::vector<bool> members;
+};
+
+struct Query {
+  bool parse(std::span<const std::string_view> args, std::string& error);
+  // resolves "in" terms from the cursor
+  bool bind(Tree& tree, std::shared_ptr<struct Person> cursor, std::string& error);
+
+  std::vector<Predicate> predicates_;
+  std::string sort_ = "id";
+  bool descending_ = false;
+  size_t limit_ = -1;
+};
+
+/*
+ * Access paths of find: people by exact first and last name, and people with
+ * a known birth year sorted by year
+ * A query is driven by the term whose path yields the fewest candidates, or by
+ * a full scan over all cores, candidates are then checked against every term
+ */
+class FindIndex {
+
+public:
+  typedef memory::unordered_map<std::string_view, memory::vector<int, memory::INDEXES>, memory::INDEXES> Names;
+
+  void build(const std::vector<std::shared_ptr<struct Person>>& people);
+  std::vector<int> run(const Query& query, const std::vector<std::shared_ptr<struct Person>>& people, const NameIndex& names, std::string& plan) const;
+
+  unsigned long version_ = -1;
+
+private:
+  Names first_;
+  Names last_;
+  memory::vector<std::pair<int, int>, memory::INDEXES> born_;
+};
+
+} // namespace genea
@@ -0,0 +1,144 @@
+#include "scan.h"
+#include "parallel.h"
+
+#include <cstring>
+#if defined(__x86_64__) || defined(__i386__)
+  #include <immintrin.h>
+#endif
+
+namespace genea {
+
+static const size_t chunkPeople = 1 << 16;
+
+
+static char fold(char c) {
+  return (c >= 'A' && c <= 'Z') ? c + ('a' - 'A') : c;
+}
+
+static const char* findScalar(const char* begin, const char* end, std::string_view pattern) {
+  size_t pos = std::string_view(begin, end - begin).find(pattern);
+  return pos == std::string_view::npos ? nullptr : begin + pos;
+}
+
+#if defined(__x86_64__) || defined(__i386__)
+
+/*
+ * Blocks of positions whose first and last bytes both match the pattern's are
+ * found with two loads and two comparisons, only those are compared fully
+ */
+__attribute__((target("sse2")))
+static const char* findSse2(const char* s, const char* end, std::string_view pattern) {
+  size_t k = pattern.size();
+  if ((size_t)(end - s) < k)
+    return nullptr;
+  const char* limit = end - k + 1;
+  const __m128i first = _mm_set1_epi8(pattern[0]);
+  const __m128i last = _mm_set1_epi8(pattern[k - 1]);
+  for (; s + 16 <= limit; s += 16) {
+    __m128i a = _mm_loadu_si128((const __m128i*)s);
+    __m128i b = _mm_loadu_si128((const __m128i*)(s + k - 1));
+    unsigned mask = _mm_movemask_epi8(_mm_and_si128(_mm_cmpeq_epi8(a, first), _mm_cmpeq_epi8(b, last)));
+    while (mask) {
+      int bit = __builtin_ctz(mask);
+      if (!memcmp(s + bit, pattern.data(), k))
+        return s + bit;
+      mask &= mask - 1;
+    }
+  }
+  return findScalar(s, end, pattern);
+}
+
+__attribute__((target("avx2")))
+static const char* findAvx2(const char* s, const char* end, std::string_view pattern) {
+  size_t k = pattern.size();
+  if ((size_t)(end - s) < k)
+    return nullptr;
+  const char* limit = end - k + 1;
+  const __m256i first = _mm256_set1_epi8(pattern[0]);
+  const __m256i last = _mm256_set1_epi8(pattern[k - 1]);
+  for (; s + 32 <= limit; s += 32) {
+    __m256i a = _mm256_loadu_si256((const __m256i*)s);
+    __m256i b = _mm256_loadu_si256((const __m256i*)(s + k - 1));
+    unsigned mask = _mm256_movemask_epi8(_mm256_and_si256(_mm256_cmpeq_epi8(a, first), _mm256_cmpeq_epi8(b, last)));
+    while (mask) {
+      int bit = __builtin_ctz(mask);
+      if (!memcmp(s + bit, pattern.data(), k))
+        return s + bit;
+      mask &= mask - 1;
+    }
+  }
+  return findSse2(s, end, pattern);
+}
+
+#endif
+
+namespace utils {
+
+const char* findSubstring(const char* begin, const char* end, std::string_view pattern) {
+  typedef const char* (*Finder)(const char*, const char*, std::string_view);
+#if defined(__x86_64__) || defined(__i386__)
+  static const Finder finder = __builtin_cpu_supports("avx2") ? &findAvx2 : __builtin_cpu_supports("sse2") ? &findSse2 : &findScalar;
+#else
+  static const Finder finder = &findScalar;
+#endif
+  return finder(begin, end, pattern);
+}
+
+} // namespace utils
+
+
+void NameIndex::build(const std::vector<std::shared_ptr<struct Person>>& people) {
+  size_t n = people.size();
+  offsets_.assign(n + 1, 0);
+  for (size_t i = 0; i < n; ++i)
+    offsets_[i + 1] = offsets_[i] + people[i]->firstName_.size() + people[i]->lastName_.size() + 3;
+  names_.resize(offsets_[n]);
+  utils::parallelFor((n + chunkPeople - 1) / chunkPeople, [&](size_t c) {
+    for (size_t i = c * chunkPeople; i < std::min(n, (c + 1) * chunkPeople); ++i) {
+      char* out = &names_[offsets_[i]];
+      *out++ = '\n';
+      for (char ch : people[i]->firstName_)
+        *out++ = fold(ch);
+      *out++ = '\n';
+      for (char ch : people[i]->lastName_)
+        *out++ = fold(ch);
+      *out = '\n';
+    }
+  });
+}
+
+std::vector<int> NameIndex::find(const std::vector<std::shared_ptr<struct Person>>& people, std::string_view name, bool contains, bool caseless) const {
+  std::string pattern = contains ? "" : "\n";
+  for (char c : name)
+    pattern += fold(c);
+  if (!contains)
+    pattern += '\n';
+
+  size_t n = offsets_.size() - 1;
+  std::vector<std::vector<int>> found((n + chunkPeople - 1) / chunkPeople);
+  utils::parallelFor(found.size(), [&](size_t c) {
+    size_t i = c * chunkPeople;
+    size_t last = std::min(n, (c + 1) * chunkPeople);
+    const char* end = names_.data() + offsets_[last];
+    const char* cur = names_.data() + offsets_[i];
+    while (const char* hit = utils::findSubstring(cur, end, pattern)) {
+      while (offsets_[i + 1] <= (uint64_t)(hit - names_.data()))
+        i++;
+      // a case-folded match is only a candidate for a case-sensitive search
+      const struct Person& p = *people[i];
+      if (caseless || (contains
+          ? p.firstName_.find(name) != std::string::npos || p.lastName_.find(name) != std::string::npos
+          : p.firstName_ == name || p.lastName_ == name))
+        found[c].push_back(i);
+      cur = names_.data() + offsets_[++i];
+      if (i == last)
+        break;
+    }
+  });
+  std::vector<int> res;
+  for (auto& ids : found)
+    res.insert(res.end(), ids.begin(), ids.end());
+  return res;
+}
+
+} // namespace genea
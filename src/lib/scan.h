@@ -0,0 +1,37 @@
+#pragma once
+
+#include "person.h"
+#include <vector>
+#include <string>
+#include <string_view>
+#include <memory>
+#include <cstdint>
+
+namespace genea {
+
+/*
+ * Case-folded copy of every name, in one buffer
+ * Each person is stored as "\nfirst\nlast\n" so that a whole name match is a
+ * substring match of "\nname\n". The buffer is scanned with SIMD kernels
+ * picked at runtime, split by ranges of people over all cores
+ */
+class NameIndex {
+
+public:
+  void build(const std::vector<std::shared_ptr<struct Person>>& people);
+  std::vector<int> find(const std::vector<std::shared_ptr<struct Person>>& people, std::string_view name, bool contains, bool caseless) const;
+
+  unsigned long version_ = -1;
+
+private:
+  std::basic_string<char, std::char_traits<char>, memory::Allocator<char, memory::INDEXES>> names_;
+  memory::vector<uint64_t, memory::INDEXES> offsets_;
+};
+
+namespace utils {
+
+const char* findSubstring(const char* begin, const char* end, std::string_view pattern);
+
+} // namespace utils
+
+} // namespace genea
@@ -0,0 +1,26 @@
+#pragma once
+
+#include <string>
+
+namespace genea {
+
+/*
+ * Outcome of an operation on a tree, nothing is printed by the library: the
+ * operation failed when error is set, a warning tells what it did that the
+ * caller may not expect, like replacing a parent
+ */
+struct Status {
+  std::string error;
+  std::string warning;
+
+  explicit operator bool() const {
+    return error.empty();
+  }
+};
+
+template <typename T>
+struct Result : Status {
+  T value = T();
+};
+
+} // namespace genea
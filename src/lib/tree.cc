@@ -0,0 +1,620 @@
+#include "tree.h"
+#include "utils.h"
+#include "archive.h"
+
+#include <fstream>
+#include <algorithm>
+#include <cstdio>
+
+namespace genea {
+
+// versions are unique among trees, so that indexes built for one tree are
+// not taken for another one's. People are owned by trees by the same numbers
+static unsigned long nextVersion() {
+  static std::atomic<unsigned long> versions = 0;
+  return ++versions;
+}
+
+static std::shared_ptr<struct Person> make(const struct Person& fields) {
+  return fields.dead_ ?
+    memory::makeShared<struct Person, memory::PEOPLE>(fields.firstName_, fields.lastName_, fields.sex_, fields.born_, *fields.dead_) :
+    memory::makeShared<struct Person, memory::PEOPLE>(fields.firstName_, fields.lastName_, fields.sex_, fields.born_);
+}
+
+static void assign(Tree& tree, int id, const struct Person& fields) {
+  std::shared_ptr<struct Person> p = tree.edit(id);
+  p->firstName_ = fields.firstName_;
+  p->lastName_ = fields.lastName_;
+  p->sex_ = fields.sex_;
+  p->born_ = fields.born_;
+  p->dead_ = fields.dead_;
+  // relations of the parents and children read the name
+  tree.edit(p->father_);
+  tree.edit(p->mother_);
+  for (int child : p->children_)
+    tree.edit(child);
+}
+
+// the children of the former and the new parent follow
+static void setParent(Tree& tree, int id, int Person::* parent, int other) {
+  if ((*tree.person(id)).*parent == other)
+    return;
+  std::shared_ptr<struct Person> p = tree.edit(id);
+  if (std::shared_ptr<struct Person> former = tree.edit((*p).*parent)) {
+    auto& children = former->children_;
+    auto found = std::find(children.begin(), children.end(), id);
+    if (found != children.end())
+      children.erase(found);
+  }
+  (*p).*parent = other;
+  if (std::shared_ptr<struct Person> added = tree.edit(other))
+    added->children_.push_back(id);
+}
+
+Traversal::Traversal(Tree& tree, std::shared_ptr<struct Person> start, bool up, size_t depth):
+tree_(&tree),
+up_(up),
+depth_(depth) {
+  if (!start)
+    return;
+  seen_.insert(start->id);
+  queue_.push_back({ std::move(start), 0 });
+}
+
+Traversal::iterator Traversal::begin() {
+  if (!started_) {
+    started_ = true;
+    next();
+  }
+  return iterator(this);
+}
+
+void Traversal::next() {
+  if (queue_.empty()) {
+    done_ = true;
+    current_ = Step();
+    return;
+  }
+  current_ = std::move(queue_.front());
+  queue_.pop_front();
+  if ((size_t)current_.generation >= depth_)
+    return;
+  struct Person& p = *current_.person;
+  auto reach = [&](int id) {
+    std::shared_ptr<struct Person> q = tree_->person(id);
+    if (q && seen_.insert(id).second)
+      queue_.push_back({ q, current_.generation + 1 });
+  };
+  if (up_) {
+    reach(p.father_);
+    reach(p.mother_);
+  } else {
+    for (int child : p.children_)
+      reach(child);
+  }
+}
+
+Tree::Tree():
+people_(std::make_shared<std::vector<std::shared_ptr<struct Person>>>()),
+version_(nextVersion()),
+owner_(nextVersion()) {}
+
+Tree Tree::fork() {
+  loadAll();
+  Tree res;
+  res.people_ = people_;
+  res.sharedTable_ = sharedTable_ = true;
+  // the people so far are owned by neither tree anymore
+  owner_ = nextVersion();
+  return res;
+}
+
+void Tree::changed() {
+  version_ = nextVersion();
+}
+
+Result<size_t> Tree::open(const std::string& file, bool lazy) {
+  Result<size_t> res;
+  std::ifstream in(file);
+  if (!in.good()) {
+    res.error = "Could not open " + file;
+    return res;
+  }
+  auto people = std::make_shared<std::vector<std::shared_ptr<struct Person>>>();
+  if (lazy && !archive::isArchive(file)) {
+    in.close();
+    auto pager = std::make_unique<Pager>(*people);
+    if (!pager->open(file)) {
+      res.error = "Could not index " + file;
+      return res;
+    }
+    close();
+    people_ = std::move(people);
+    pager_ = std::move(pager);
+    changed();
+    res.value = people_->size();
+    return res;
+  }
+  *people = archive::isArchive(file) ? archive::read(file, res.error) : utils::parseFile(in, res.error);
+  if (people->empty()) {
+    res.error = res.error.empty() ? "File is invalid or corrupted" : res.error;
+    return res;
+  }
+  for (size_t i = 0; i < people->size(); ++i) {
+    (*people)[i]->id = i;
+    (*people)[i]->owner_ = owner_;
+  }
+  close();
+  people_ = std::move(people);
+  changed();
+  res.value = people_->size();
+  return res;
+}
+
+Result<size_t> Tree::load(const std::string& file) {
+  Result<size_t> res;
+  std::ifstream in(file);
+  if (!in.good()) {
+    res.error = "Could not open " + file;
+    return res;
+  }
+  std::vector<std::shared_ptr<struct Person>> people = archive::isArchive(file) ? archive::read(file, res.error) : utils::parseFile(in, res.error);
+  if (people.empty()) {
+    res.error = res.error.empty() ? "Could not load file" : res.error;
+    return res;
+  }
+  loadAll();
+  ownTable();
+  // the links of the file are ids among its people
+  int offset = people_->size();
+  for (auto& person : people) {
+    person->id = people_->size();
+    person->owner_ = owner_;
+    for (int* parent : { &person->father_, &person->mother_ }) {
+      if (*parent != -1)
+        *parent += offset;
+    }
+    for (int& child : person->children_)
+      child += offset;
+    people_->push_back(person);
+  }
+  changed();
+  res.value = people.size();
+  return res;
+}
+
+Status Tree::dump(const std::string& file, bool compact, const Progress& progress) {
+  Status res;
+  loadAll();
+  auto& people = *people_;
+  auto cancelled = [&progress]() {
+    return progress.cancel && *progress.cancel;
+  };
+  auto step = [&progress, &cancelled]() {
+    return !progress.done || ++*progress.done % 4096 || !cancelled();
+  };
+  if (progress.total)
+    *progress.total = compact ? 1 : 2 * people.size();
+  if (compact) {
+    if (!archive::write(file, people)) {
+      res.error = "Could not write to file " + file;
+      return res;
+    }
+    if (progress.done)
+      *progress.done = 1;
+    return res;
+  }
+  std::ofstream out(file);
+  if (!out.good()) {
+    res.error = "Could not write to file " + file;
+    return res;
+  }
+  out << people.size() << std::endl;
+  for (auto& person : people) {
+    out << person->dump() << std::endl;
+    if (!step())
+      break;
+  }
+  for (auto& person : people) {
+    if (cancelled())
+      break;
+    out << person->father_ << ' ' << person->mother_ << std::endl;
+    if (!step())
+      break;
+  }
+  out.close();
+  if (cancelled()) {
+    std::remove(file.c_str());
+    res.error = "cancelled";
+  }
+  return res;
+}
+
+Status Tree::dump(const std::string& file, const Branch& branch, bool compact, const Progress& progress) {
+  Tree extracted = extract(branch);
+  if (!extracted.size()) {
+    Status res;
+    res.error = "No person to start from";
+    return res;
+  }
+  return extracted.dump(file, compact, progress);
+}
+
+Tree Tree::extract(const Branch& branch, std::vector<int>* generations) {
+  std::vector<Traversal::Step> steps = this->branch(branch);
+  std::sort(steps.begin(), steps.end(), [](const Traversal::Step& a, const Traversal::Step& b) {
+    return a.person->id < b.person->id;
+  });
+  // the rank among the people of the branch, -1 for the others
+  auto index = [&steps](int id) {
+    auto found = std::lower_bound(steps.begin(), steps.end(), id, [](const Traversal::Step& step, int id) {
+      return step.person->id < id;
+    });
+    return id != -1 && found != steps.end() && found->person->id == id ? (int)(found - steps.begin()) : -1;
+  };
+  Tree res;
+  auto& people = *res.people_;
+  people.resize(steps.size());
+  for (size_t i = 0; i < steps.size(); ++i) {
+    people[i] = make(*steps[i].person);
+    people[i]->id = i;
+    people[i]->owner_ = res.owner_;
+  }
+  for (size_t i = 0; i < steps.size(); ++i) {
+    for (int Person::* parent : { &Person::father_, &Person::mother_ }) {
+      int id = index((*steps[i].person).*parent);
+      if (id == -1)
+        continue;
+      (*people[i]).*parent = id;
+      people[id]->children_.push_back(i);
+    }
+  }
+  if (generations) {
+    generations->resize(steps.size());
+    for (size_t i = 0; i < steps.size(); ++i)
+      (*generations)[i] = steps[i].generation;
+  }
+  return res;
+}
+
+std::shared_ptr<struct Person> Tree::person(int id) {
+  if (id < 0 || (size_t)id >= people_->size())
+    return nullptr;
+  if (!(*people_)[id])
+    return pager_->get(id);
+  return (*people_)[id];
+}
+
+const std::vector<std::shared_ptr<struct Person>>& Tree::people() {
+  loadAll();
+  return *people_;
+}
+
+void Tree::loadAll() {
+  if (!pager_)
+    return;
+  pager_->loadAll();
+  pager_ = nullptr;
+}
+
+std::shared_ptr<struct Person> Tree::edit(int id) {
+  std::shared_ptr<struct Person> p = person(id);
+  if (!p)
+    return nullptr;
+  if (p->owner_ != owner_) {
+    ownTable();
+    p = memory::makeShared<struct Person, memory::PEOPLE>(*p);
+    p->owner_ = owner_;
+    (*people_)[id] = p;
+  }
+  p->touch();
+  return p;
+}
+
+void Tree::ownTable() {
+  if (!sharedTable_)
+    return;
+  people_ = std::make_shared<std::vector<std::shared_ptr<struct Person>>>(*people_);
+  sharedTable_ = false;
+}
+
+std::shared_ptr<struct Person> Tree::own(const std::shared_ptr<struct Person>& p) {
+  return p ? person(p->id) : nullptr;
+}
+
+std::vector<int> Tree::evict() {
+  if (!pager_)
+    return {};
+  pager_->evict();
+  std::vector<int> res;
+  res.swap(pager_->corrupted_);
+  return res;
+}
+
+void Tree::close() {
+  pager_ = nullptr;
+  people_ = std::make_shared<std::vector<std::shared_ptr<struct Person>>>();
+  sharedTable_ = false;
+  memo_.clear();
+  changed();
+}
+
+std::shared_ptr<struct Person> Tree::create(const struct Person& fields) {
+  ownTable();
+  std::shared_ptr<struct Person> created = make(fields);
+  created->id = people_->size();
+  created->owner_ = owner_;
+  people_->push_back(created);
+  changed();
+  return created;
+}
+
+Result<std::shared_ptr<struct Person>> Tree::add(std::shared_ptr<struct Person> from, std::string_view relations, const struct Person& fields) {
+  Result<std::shared_ptr<struct Person>> res;
+  auto [path, relation] = utils::splitRelation(relations);
+  auto p = this->relation(from, path);
+  if (!p || p.value.size() != 1) {
+    res.error = !p ? p.error : p.value.empty() ? "Could not get to that relation" : "Grouping relation must be last";
+    return res;
+  }
+  // in the tree before it is linked, taken back if it cannot be
+  ownTable();
+  std::shared_ptr<struct Person> created = make(fields);
+  created->id = people_->size();
+  created->owner_ = owner_;
+  people_->push_back(created);
+  if (!utils::setRelation(*this, relation, p.value[0], created, res)) {
+    people_->pop_back();
+    res.error = res.error.empty() ? "Could not create relation" : res.error;
+    return res;
+  }
+  changed();
+  res.value = created;
+  return res;
+}
+
+Status Tree::attach(std::shared_ptr<struct Person> from, std::string_view relations, std::shared_ptr<struct Person> other) {
+  Status res;
+  other = own(other);
+  if (!other) {
+    res.error = "No person to attach";
+    return res;
+  }
+  auto [path, relation] = utils::splitRelation(relations);
+  auto p = this->relation(from, path);
+  if (!p || p.value.size() != 1) {
+    res.error = !p ? p.error : p.value.empty() ? "Could not get to that relation" : "Grouping relation must be last";
+    return res;
+  }
+  if (!utils::setRelation(*this, relation, p.value[0], other, res))
+    res.error = res.error.empty() ? "Could not set relation" : res.error;
+  return res;
+}
+
+Status Tree::detach(std::shared_ptr<struct Person> from, std::string_view relations) {
+  Status res;
+  auto [path, relation] = utils::splitRelation(relations);
+  auto p = this->relation(from, path);
+  if (!p || p.value.size() != 1) {
+    res.error = !p ? p.error : p.value.empty() ? "Could not get to that relation" : "Can't remove a grouping relation";
+    return res;
+  }
+  if (!utils::rmRelation(*this, relation, p.value[0], res))
+    res.error = res.error.empty() ? "Could not remove relation" : res.error;
+  return res;
+}
+
+void Tree::remove(int id) {
+  if (id < 0 || (size_t)id >= people_->size())
+    return;
+  loadAll();
+  std::shared_ptr<struct Person> p = person(id);
+  for (int parent : { p->father_, p->mother_ }) {
+    if (std::shared_ptr<struct Person> q = edit(parent)) {
+      auto& children = q->children_;
+      children.erase(std::remove(children.begin(), children.end(), id), children.end());
+    }
+  }
+  for (int child : p->children_) {
+    if (std::shared_ptr<struct Person> c = edit(child)) {
+      if (c->father_ == id)
+        c->father_ = -1;
+      if (c->mother_ == id)
+        c->mother_ = -1;
+    }
+  }
+  ownTable();
+  auto& people = *people_;
+  people.erase(people.begin() + id);
+  // the ids after it shift down, which changes the people with these ids and
+  // the people linked to them
+  auto shifts = [id](int link) {
+    return link > id;
+  };
+  for (size_t i = 0; i < people.size(); ++i) {
+    const struct Person& q = *people[i];
+    if (q.id <= id && !shifts(q.father_) && !shifts(q.mother_) && std::none_of(q.children_.begin(), q.children_.end(), shifts))
+      continue;
+    std::shared_ptr<struct Person> shifted = edit(i);
+    shifted->id = i;
+    for (int* link : { &shifted->father_, &shifted->mother_ }) {
+      if (shifts(*link))
+        (*link)--;
+    }
+    for (int& child : shifted->children_) {
+      if (shifts(child))
+        child--;
+    }
+  }
+  memo_.clear();
+  changed();
+}
+
+void Tree::overwrite(std::shared_ptr<struct Person> p, const struct Person& fields) {
+  p = own(p);
+  if (!p)
+    return;
+  assign(*this, p->id, fields);
+  changed();
+}
+
+Status Tree::patch(const merkle::Patch& patch) {
+  Status res;
+  loadAll();
+  if (people_->size() != patch.size || merkle::compute(*people_).numbered != patch.base) {
+    res.error = "The patch was not made from this tree";
+    return res;
+  }
+  int size = patch.size;
+  int total = size + patch.added.size();
+  bool valid = true;
+  for (int id : patch.removed)
+    valid = valid && id >= 0 && id < size;
+  for (auto& [id, fields] : patch.changed)
+    valid = valid && id >= 0 && id < size && fields;
+  for (auto& fields : patch.added)
+    valid = valid && fields;
+  for (auto& link : patch.links)
+    valid = valid && link.id >= 0 && link.id < total && link.father >= -1 && link.father < total && link.mother >= -1 && link.mother < total;
+  if (!valid) {
+    res.error = "Patch is invalid or corrupted";
+    return res;
+  }
+  for (auto& [id, fields] : patch.changed)
+    assign(*this, id, *fields);
+  ownTable();
+  for (auto& fields : patch.added) {
+    std::shared_ptr<struct Person> added = make(*fields);
+    added->id = people_->size();
+    added->owner_ = owner_;
+    people_->push_back(added);
+  }
+  for (auto& link : patch.links) {
+    setParent(*this, link.id, &Person::father_, link.father);
+    setParent(*this, link.id, &Person::mother_, link.mother);
+  }
+  std::vector<char> removed(people_->size(), 0);
+  for (int id : patch.removed) {
+    removed[id] = 1;
+    setParent(*this, id, &Person::father_, -1);
+    setParent(*this, id, &Person::mother_, -1);
+    std::vector<int> children(person(id)->children_.begin(), person(id)->children_.end());
+    for (int child : children) {
+      std::shared_ptr<struct Person> c = person(child);
+      if (c && (c->father_ == id || c->mother_ == id))
+        setParent(*this, child, c->father_ == id ? &Person::father_ : &Person::mother_, -1);
+    }
+  }
+  // one pass, so the ids shift once, changing the people whose id or links do
+  auto& people = *people_;
+  std::vector<int> ids(people.size(), -1);
+  int kept = 0;
+  for (size_t i = 0; i < people.size(); ++i) {
+    if (!removed[i])
+      ids[i] = kept++;
+  }
+  auto moves = [&ids](int link) {
+    return link != -1 && ids[link] != link;
+  };
+  for (size_t i = 0; i < people.size(); ++i) {
+    const struct Person& q = *people[i];
+    if (removed[i] || (!moves(q.id) && !moves(q.father_) && !moves(q.mother_) && std::none_of(q.children_.begin(), q.children_.end(), moves)))
+      continue;
+    std::shared_ptr<struct Person> p = edit(i);
+    p->id = ids[i];
+    for (int* link : { &p->father_, &p->mother_ }) {
+      if (*link != -1)
+        *link = ids[*link];
+    }
+    for (int& child : p->children_)
+      child = ids[child];
+  }
+  for (size_t i = 0; i < people.size(); ++i) {
+    if (!removed[i])
+      people[ids[i]] = std::move(people[i]);
+  }
+  people.resize(kept);
+  memo_.clear();
+  changed();
+  if (merkle::compute(people).tree != patch.target)
+    res.warning = "Warning: the patched tree is not the one the patch was made for";
+  return res;
+}
+
+merkle::Hashes Tree::hashes() {
+  return merkle::compute(people());
+}
+
+std::vector<integrity::Issue> Tree::check(bool repair) {
+  loadAll();
+  std::vector<integrity::Issue> issues = integrity::check(*people_);
+  if (repair && !issues.empty()) {
+    // the table read by the repair stays the one changed
+    ownTable();
+    integrity::repair(*this, issues);
+    memo_.clear();
+  }
+  return issues;
+}
+
+Result<std::vector<std::shared_ptr<struct Person>>> Tree::relation(const std::shared_ptr<struct Person>& from, std::string_view relations) {
+  Result<std::vector<std::shared_ptr<struct Person>>> res;
+  // the person of this tree now, which the one given may be an older copy of
+  std::shared_ptr<struct Person> start = own(from);
+  if (!start) {
+    res.error = "No person to start from";
+    return res;
+  }
+  if (pager_)
+    res.value = utils::computeRelation(*this, relations, start, res);
+  else
+    res.value = memo_.find(*this, relations, start, res);
+  return res;
+}
+
+Traversal Tree::ancestors(const std::shared_ptr<struct Person>& p, size_t depth) {
+  return Traversal(*this, own(p), true, depth);
+}
+
+Traversal Tree::descendants(const std::shared_ptr<struct Person>& p, size_t depth) {
+  return Traversal(*this, own(p), false, depth);
+}
+
+std::vector<Traversal::Step> Tree::branch(const Branch& branch) {
+  std::vector<Traversal::Step> res;
+  // a bit per person rather than a set, the steps found are the queue
+  std::vector<bool> reached(people_->size(), false);
+  auto reach = [&](int id, int generation) {
+    if (id < 0 || (size_t)id >= reached.size() || reached[id])
+      return;
+    reached[id] = true;
+    res.push_back({ person(id), generation });
+  };
+  reach(branch.from, 0);
+  // ancestors only go up and descendants down, the start both ways
+  for (size_t i = 0; i < res.size(); ++i) {
+    std::shared_ptr<struct Person> p = res[i].person;
+    int generation = res[i].generation;
+    if (generation <= 0 && (size_t)-generation < branch.ancestors) {
+      reach(p->father_, generation - 1);
+      reach(p->mother_, generation - 1);
+    }
+    if (generation >= 0 && (size_t)generation < branch.descendants) {
+      for (int child : p->children_)
+        reach(child, generation + 1);
+    }
+  }
+  // once the walk is over, so that no ancestor is taken for a spouse first
+  if (branch.spouses) {
+    for (size_t i = 0, n = res.size(); i < n; ++i) {
+      std::shared_ptr<struct Person> p = res[i].person;
+      for (int id : p->children_) {
+        if (std::shared_ptr<struct Person> child = person(id))
+          reach(child->father_ == p->id ? child->mother_ : child->father_, res[i].generation);
+      }
+    }
+  }
+  return res;
+}
+
+} // namespace genea
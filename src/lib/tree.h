@@ -0,0 +1,229 @@
+#pragma once
+
+#include "person.h"
+#include "status.h"
+#include "pager.h"
+#include "memo.h"
+#include "merkle.h"
+#include "integrity.h"
+#include <vector>
+#include <string>
+#include <string_view>
+#include <memory>
+#include <deque>
+#include <unordered_set>
+#include <iterator>
+#include <atomic>
+
+namespace genea {
+
+class Tree;
+
+/*
+ * Breadth first walk over the ancestors or the descendants of a person, each
+ * of them once with the number of generations from the start, nearest first
+ */
+class Traversal {
+
+public:
+  struct Step {
+    std::shared_ptr<struct Person> person;
+    int generation;
+  };
+
+  class iterator {
+
+  public:
+    typedef std::input_iterator_tag iterator_category;
+    typedef Step value_type;
+    typedef std::ptrdiff_t difference_type;
+    typedef const Step* pointer;
+    typedef const Step& reference;
+
+    iterator() = default;
+
+    const Step& operator*() const {
+      return walk_->current_;
+    }
+
+    const Step* operator->() const {
+      return &walk_->current_;
+    }
+
+    iterator& operator++() {
+      walk_->next();
+      return *this;
+    }
+
+    void operator++(int) {
+      walk_->next();
+    }
+
+    bool operator==(std::default_sentinel_t) const {
+      return walk_->done_;
+    }
+
+  private:
+    friend class Traversal;
+
+    iterator(Traversal* walk): walk_(walk) {}
+
+    Traversal* walk_ = nullptr;
+  };
+
+  // the start itself comes first, at generation 0
+  Traversal(Tree& tree, std::shared_ptr<struct Person> start, bool up, size_t depth);
+
+  iterator begin();
+
+  std::default_sentinel_t end() const {
+    return std::default_sentinel;
+  }
+
+private:
+  void next();
+
+  Tree* tree_;
+  bool up_;
+  size_t depth_;
+  bool started_ = false;
+  bool done_ = false;
+  Step current_;
+  std::deque<Step> queue_;
+  std::unordered_set<int> seen_;
+};
+
+// for the long operations run on another thread
+struct Progress {
+  // set from the other thread to stop, nothing is left half written
+  const std::atomic<bool>* cancel = nullptr;
+  // units done so far, out of total
+  std::atomic<size_t>* done = nullptr;
+  std::atomic<size_t>* total = nullptr;
+};
+
+// a person with their ancestors and descendants up to some generations
+struct Branch {
+  int from = -1;
+  size_t ancestors = 0;
+  size_t descendants = 0;
+  // the other parents of the children of everyone in it
+  bool spouses = false;
+};
+
+/*
+ * A genealogic tree, the library's entry point
+ * People are numbered by their index. Relations are chains as in the CLI
+ * ("father.sibling:Alice.child"), computed through a memo unless the tree is
+ * lazy. People link each other by id, through the table of their tree.
+ * Forks share the table and each person until one of them changes it: that
+ * tree then takes a copy of the person, and of the table on its first change.
+ * Removing someone copies the people whose ids or links shift. The people
+ * obtained from a tree are only valid until its next change
+ */
+class Tree {
+
+public:
+  Tree();
+  Tree(Tree&&) = default;
+  Tree& operator=(Tree&&) = default;
+
+  // a tree with the same people as this one, until either of them changes
+  Tree fork();
+
+  // replaces the people by those of a .genea file or an archive, returns
+  // their count. A lazy tree only reads the people of a .genea file when they
+  // are reached
+  Result<size_t> open(const std::string& file, bool lazy = false);
+  // appends the people of a file, returns their count
+  Result<size_t> load(const std::string& file);
+  // as a .genea file, or an archive when compact
+  Status dump(const std::string& file, bool compact = false, const Progress& progress = Progress());
+  // only the people of a branch, as extracted
+  Status dump(const std::string& file, const Branch& branch, bool compact = false, const Progress& progress = Progress());
+  // a tree of copies of the people of a branch, numbered in the order of this
+  // one and linked among themselves, with their generations from its start
+  // by id. Only the branch is read when this tree is lazy
+  Tree extract(const Branch& branch, std::vector<int>* generations = nullptr);
+
+  size_t size() const {
+    return people_->size();
+  }
+
+  bool lazy() const {
+    return pager_ != nullptr;
+  }
+
+  // bumped whenever people are added, removed or renamed, unique among trees
+  unsigned long version() const {
+    return version_;
+  }
+
+  // nullptr for an id out of range
+  std::shared_ptr<struct Person> person(int id);
+  // everyone, read in full first when the tree is lazy
+  const std::vector<std::shared_ptr<struct Person>>& people();
+  void loadAll();
+  // the person to change, copied first when shared with a fork. nullptr for
+  // an id out of range
+  std::shared_ptr<struct Person> edit(int id);
+
+  // people read by a lazy tree that are no longer needed go, records that
+  // could not be read since the last call are returned
+  std::vector<int> evict();
+  // drops the people, as when the tree goes
+  void close();
+
+  std::shared_ptr<struct Person> create(const struct Person& fields);
+  // a new person, set as the last relation of the chain from a person
+  Result<std::shared_ptr<struct Person>> add(std::shared_ptr<struct Person> from, std::string_view relations, const struct Person& fields);
+  // sets other as the last relation of the chain from a person
+  Status attach(std::shared_ptr<struct Person> from, std::string_view relations, std::shared_ptr<struct Person> other);
+  // unsets the last relation of the chain from a person
+  Status detach(std::shared_ptr<struct Person> from, std::string_view relations);
+  // the person goes with all their links, the ids after theirs shift down
+  void remove(int id);
+  void overwrite(std::shared_ptr<struct Person> p, const struct Person& fields);
+  // applies a patch made from a tree with the same content, a warning tells
+  // when the result is not the tree it was made for
+  Status patch(const merkle::Patch& patch);
+
+  Result<std::vector<std::shared_ptr<struct Person>>> relation(const std::shared_ptr<struct Person>& from, std::string_view relations);
+  Traversal ancestors(const std::shared_ptr<struct Person>& p, size_t depth = -1);
+  Traversal descendants(const std::shared_ptr<struct Person>& p, size_t depth = -1);
+  // everyone in a branch once, nearest first, with the number of generations
+  // from its start, negative above it. Spouses take the generation of the
+  // person they were found from
+  std::vector<Traversal::Step> branch(const Branch& branch);
+
+  merkle::Hashes hashes();
+  // the broken invariants, repaired when asked as far as they can be
+  std::vector<integrity::Issue> check(bool repair = false);
+
+  const RelationMemo& memo() const {
+    return memo_;
+  }
+
+  // the table of people, shared with forks
+  const std::vector<std::shared_ptr<struct Person>>* table() const {
+    return people_.get();
+  }
+
+private:
+  // the person of this tree with the id of p, which may be an older copy or
+  // come from a fork
+  std::shared_ptr<struct Person> own(const std::shared_ptr<struct Person>& p);
+  // copies the table before it changes when it is shared with a fork
+  void ownTable();
+  void changed();
+
+  std::shared_ptr<std::vector<std::shared_ptr<struct Person>>> people_;
+  bool sharedTable_ = false;
+  std::unique_ptr<Pager> pager_;
+  RelationMemo memo_;
+  unsigned long version_;
+  // the people it may change in place carry it
+  unsigned long owner_;
+};
+
+} // namespace genea
@@ -0,0 +1,533 @@
+#include "utils.h"
+#include "tree.h"
+#include <set>
+#include <algorithm>
+#include <utility>
+#include <fstream>
+#include <cassert>
+#include <charconv>
+#include <string_view>
+#include <span>
+#include "dispatch.h"
+
+namespace genea {
+
+namespace relation {
+
+// warnings of the steps of a relation are kept one per line
+static void warn(Status& status, std::string_view warning) {
+  if (!status.warning.empty())
+    status.warning += '\n';
+  status.warning += warning;
+}
+
+std::vector<std::shared_ptr<struct Person>> children(Tree& tree, std::shared_ptr<struct Person> p) {
+  std::vector<std::shared_ptr<struct Person>> res;
+  for (int child : p->children_)
+    res.push_back(tree.person(child));
+  return res;
+}
+
+std::vector<std::shared_ptr<struct Person>> siblings(Tree& tree, std::shared_ptr<struct Person> p) {
+  std::vector<int> res;
+  if (auto father = tree.person(p->father_)) {
+    for (int child : father->children_) {
+      if (child != p->id)
+        res.push_back(child);
+    }
+  }
+  if (auto mother = tree.person(p->mother_)) {
+    for (int child : mother->children_) {
+      auto c = std::find(res.begin(), res.end(), child);
+      if (c == res.end() && child != p->id)
+        res.push_back(child);
+    }
+  }
+  std::vector<std::shared_ptr<struct Person>> people;
+  for (int sibling : res)
+    people.push_back(tree.person(sibling));
+  return people;
+}
+
+std::shared_ptr<struct Person> father(Tree& tree, std::shared_ptr<struct Person> p, std::string_view specifier, Status& status) {
+  if (!specifier.empty()) {
+    status.error = "father: can't use specifier";
+    return nullptr;
+  }
+  return tree.person(p->father_);
+}
+
+std::shared_ptr<struct Person> mother(Tree& tree, std::shared_ptr<struct Person> p, std::string_view specifier, Status& status) {
+  if (!specifier.empty()) {
+    status.error = "mother: can't use specifier";
+    return nullptr;
+  }
+  return tree.person(p->mother_);
+}
+
+std::shared_ptr<struct Person> child(Tree& tree, std::shared_ptr<struct Person> p, std::string_view specifier, Status&) {
+  for (int id : p->children_) {
+    std::shared_ptr<struct Person> c = tree.person(id);
+    if (c->firstName_ == specifier || specifier.empty())
+      return c;
+  }
+  return nullptr;
+}
+
+std::shared_ptr<struct Person> sibling(Tree& tree, std::shared_ptr<struct Person> p, std::string_view specifier, Status&) {
+  std::vector<std::shared_ptr<struct Person>> s = siblings(tree, p);
+  for (auto& sib : s) {
+    if (sib->firstName_ == specifier || specifier.empty())
+      return sib;
+  }
+  return nullptr;
+}
+
+std::shared_ptr<struct Person> spouse(Tree& tree, std::shared_ptr<struct Person> p, std::string_view specifier, Status&) {
+  for (int id : p->children_) {
+    std::shared_ptr<struct Person> child = tree.person(id);
+    if (p->id == child->father_ && child->mother_ != -1) {
+      std::shared_ptr<struct Person> mother = tree.person(child->mother_);
+      if (specifier.empty() || mother->firstName_ == specifier)
+        return mother;
+    }
+    if (p->id == child->mother_ && child->father_ != -1) {
+      std::shared_ptr<struct Person> father = tree.person(child->father_);
+      if (specifier.empty() || father->firstName_ == specifier)
+        return father;
+    }
+  }
+  return nullptr;
+}
+
+// people are changed through the tree, which copies those shared with a fork
+static bool setParent(Tree& tree, std::shared_ptr<struct Person> p, int Person::* parent, std::shared_ptr<struct Person> other, std::string_view warning, Status& status) {
+  p = tree.edit(p->id);
+  other = tree.edit(other->id);
+  if ((*p).*parent != -1) {
+    std::shared_ptr<struct Person> former = tree.edit((*p).*parent);
+    warn(status, warning);
+    auto child = std::find(former->children_.begin(), former->children_.end(), p->id);
+    assert(child != former->children_.end());
+    former->children_.erase(child);
+  }
+  (*p).*parent = other->id;
+  other->children_.push_back(p->id);
+  return true;
+}
+
+bool setFather(Tree& tree, std::shared_ptr<struct Person> p, std::shared_ptr<struct Person> other, Status& status) {
+  return setParent(tree, p, &Person::father_, other, "Warning: father already exists and is being replaced", status);
+}
+
+bool setMother(Tree& tree, std::shared_ptr<struct Person> p, std::shared_ptr<struct Person> other, Status& status) {
+  return setParent(tree, p, &Person::mother_, other, "Warning: mother already exists and is being replaced", status);
+}
+
+bool setChild(Tree& tree, std::shared_ptr<struct Person> p, std::shared_ptr<struct Person> other, Status& status) {
+  if (p->sex_ == Sex::MALE)
+    return setFather(tree, other, p, status);
+  return setMother(tree, other, p, status);
+}
+
+bool setSibling(Tree& tree, std::shared_ptr<struct Person> p, std::shared_ptr<struct Person> other, Status& status) {
+  if (p->father_ == -1 && p->mother_ == -1) {
+    status.error = "Error: No parent known, impossible to create sibling";
+    return false;
+  }
+  int father = p->father_;
+  int mother = p->mother_;
+  if (father != -1) {
+    setFather(tree, other, tree.person(father), status);
+  }
+  if (mother != -1) {
+    setMother(tree, other, tree.person(mother), status);
+  }
+  return true;
+}
+
+static bool rmParent(Tree& tree, std::shared_ptr<struct Person> p, int Person::* parent, std::string_view name, std::string_view specifier, Status& status) {
+  if (!specifier.empty()) {
+    status.error = std::string(name) + ": can't use specifier";
+    return false;
+  }
+  if ((*p).*parent == -1) {
+    status.error = "Warning: " + std::string(name) + " does not exist";
+    return false;
+  }
+  p = tree.edit(p->id);
+  std::shared_ptr<struct Person> former = tree.edit((*p).*parent);
+  auto child = std::find(former->children_.begin(), former->children_.end(), p->id);
+  assert(child != former->children_.end());
+  former->children_.erase(child);
+  (*p).*parent = -1;
+  return true;
+}
+
+bool rmFather(Tree& tree, std::shared_ptr<struct Person> p, std::string_view specifier, Status& status) {
+  return rmParent(tree, p, &Person::father_, "father", specifier, status);
+}
+
+bool rmMother(Tree& tree, std::shared_ptr<struct Person> p, std::string_view specifier, Status& status) {
+  return rmParent(tree, p, &Person::mother_, "mother", specifier, status);
+}
+
+bool rmChild(Tree& tree, std::shared_ptr<struct Person> p, std::string_view specifier, Status& status) {
+  if (specifier.empty()) {
+    status.error = "child: removing needs a specifier";
+    return false;
+  }
+  auto found = std::find_if(p->children_.begin(), p->children_.end(), [&](int c) {
+    return tree.person(c)->firstName_ == specifier;
+  });
+  if (found == p->children_.end()) {
+    status.error = "child: " + std::string(specifier) + " not found";
+    return false;
+  }
+  size_t index = found - p->children_.begin();
+  p = tree.edit(p->id);
+  std::shared_ptr<struct Person> child = tree.edit(p->children_[index]);
+  if (p->id == child->mother_) {
+    child->mother_ = -1;
+    p->children_.erase(p->children_.begin() + index);
+    return true;
+  }
+  if (p->id == child->father_) {
+    child->father_ = -1;
+    p->children_.erase(p->children_.begin() + index);
+    return true;
+  }
+  assert(false);
+}
+
+typedef std::shared_ptr<struct Person> (*Relation)(Tree&, std::shared_ptr<struct Person>, std::string_view, Status&);
+typedef std::vector<std::shared_ptr<struct Person>> (*RelationGroup)(Tree&, std::shared_ptr<struct Person>);
+typedef bool (*SetRelation)(Tree&, std::shared_ptr<struct Person>, std::shared_ptr<struct Person>, Status&);
+typedef bool (*RmRelation)(Tree&, std::shared_ptr<struct Person>, std::string_view, Status&);
+
+constexpr std::pair<std::string_view, Relation> relations[] = {
+  { "father", &father },
+  { "mother", &mother },
+  { "child", &child },
+  { "sibling", &sibling },
+  { "spouse", &spouse }
+};
+constexpr utils::PerfectHash<Relation, std::size(relations)> getRelation(relations);
+
+constexpr std::pair<std::string_view, RelationGroup> relationGroups[] = {
+  { "children", &children },
+  { "siblings", &siblings }
+};
+constexpr utils::PerfectHash<RelationGroup, std::size(relationGroups)> getRelationGroup(relationGroups);
+
+constexpr std::pair<std::string_view, SetRelation> setRelations[] = {
+  { "father", &setFather },
+  { "mother", &setMother },
+  { "child", &setChild },
+  { "sibling", &setSibling }
+};
+constexpr utils::PerfectHash<SetRelation, std::size(setRelations)> setRelation(setRelations);
+
+constexpr std::pair<std::string_view, RmRelation> rmRelations[] = {
+  { "father", &rmFather },
+  { "mother", &rmMother },
+  { "child", &rmChild }
+};
+constexpr utils::PerfectHash<RmRelation, std::size(rmRelations)> rmRelation(rmRelations);
+
+
+} // namespace relation
+
+namespace utils {
+
+// relation chains are read in place, separated by points
+// people whose links or children's names a relation from p reads
+static void reads(Tree& tree, std::string_view relation, const std::shared_ptr<struct Person>& p, std::vector<std::shared_ptr<struct Person>>* res) {
+  if (!res)
+    return;
+  res->push_back(p);
+  if (relation == "sibling" || relation == "siblings") {
+    if (p->father_ != -1)
+      res->push_back(tree.person(p->father_));
+    if (p->mother_ != -1)
+      res->push_back(tree.person(p->mother_));
+  } else if (relation == "spouse") {
+    for (int child : p->children_)
+      res->push_back(tree.person(child));
+  }
+}
+
+std::vector<std::shared_ptr<struct Person>> computeRelation(Tree& tree, std::string_view relations, std::shared_ptr<struct Person> start, Status& status, std::vector<std::shared_ptr<struct Person>>* read) {
+  std::shared_ptr<struct Person> p = start;
+  unsigned cpt = 0;
+  while (relations.size()) {
+    size_t dot = relations.find('.');
+    std::string_view r = relations.substr(0, dot);
+    relations = (dot == std::string_view::npos ? std::string_view() : relations.substr(dot + 1));
+    if (r.empty())
+      continue;
+    cpt++;
+    auto group = relation::getRelationGroup.find(r);
+    bool last = (relations.find_first_not_of('.') == std::string_view::npos);
+    if (last && group) {
+      reads(tree, r, p, read);
+      return (*group)(tree, p);
+    }
+    if (!last && group) {
+      status.error = "Relation '" + std::string(r) + "' (" + std::to_string(cpt) + "): grouping relations must be placed last";
+      return {};
+    }
+    auto colon = r.find(':');
+    std::string_view rel = (colon == std::string_view::npos ? r : r.substr(0, colon));
+    std::string_view spec = (colon == std::string_view::npos ? "" : r.substr(colon + 1));
+    if (auto get = relation::getRelation.find(rel)) {
+      reads(tree, rel, p, read);
+      p = (*get)(tree, p, spec, status);
+      if (!p) {
+        if (status)
+          status.error = "Relation '" + std::string(r) + "' (" + std::to_string(cpt) + "): is not set";
+        return {};
+      }
+    } else {
+      status.error = "Relation '" + std::string(r) + "' (" + std::to_string(cpt) + "): unknown relation";
+      return {};
+    }
+  }
+  return { p };
+}
+
+std::pair<std::string_view, std::string_view> splitRelation(std::string_view relations) {
+  size_t end = relations.find_last_not_of('.');
+  relations = relations.substr(0, end == std::string_view::npos ? 0 : end + 1);
+  size_t dot = relations.rfind('.');
+  if (dot == std::string_view::npos)
+    return { std::string_view(), relations };
+  return { relations.substr(0, dot), relations.substr(dot + 1) };
+}
+
+
+bool setRelation(Tree& tree, std::string_view relation, std::shared_ptr<struct Person> p, std::shared_ptr<struct Person> other, Status& status) {
+  auto set = relation::setRelation.find(relation);
+  if (!set) {
+    status.error = "Relation '" + std::string(relation) + "' (last): Unknown relation";
+    return false;
+  }
+  return (*set)(tree, p, other, status);
+}
+
+bool rmRelation(Tree& tree, std::string_view relation, std::shared_ptr<struct Person> p, Status& status) {
+  auto colon = relation.find(':');
+  std::string_view rel = (colon == std::string_view::npos ? relation : relation.substr(0, colon));
+  std::string_view spec = (colon == std::string_view::npos ? "" : relation.substr(colon + 1));
+  auto rm = relation::rmRelation.find(rel);
+  if (!rm) {
+    status.error = "Relation '" + std::string(relation) + "' (last): Unknown relation";
+    return false;
+  }
+  return (*rm)(tree, p, spec, status);
+}
+
+// same fields as sscanf's "%d/%d/%d", "%d/%d" then "%d"
+static int parseInts(std::string_view s, int* values, int max) {
+  const char* cur = s.data();
+  const char* end = s.data() + s.size();
+  int n = 0;
+  while (n < max) {
+    if (cur < end && *cur == '+')
+      cur++;
+    auto res = std::from_chars(cur, end, values[n]);
+    if (res.ec != std::errc())
+      break;
+    n++;
+    cur = res.ptr;
+    if (cur == end || *cur != '/')
+      break;
+    cur++;
+  }
+  return n;
+}
+
+bool parseDate(std::string_view s, struct Date* d) {
+  if (s == "?")
+    return true;
+  int values[3];
+  switch (parseInts(s, values, 3)) {
+  case 3:
+    d->day_ = values[0];
+    d->month_ = values[1];
+    d->year_ = values[2];
+    return true;
+  case 2:
+    d->month_ = values[0];
+    d->year_ = values[1];
+    return true;
+  case 1:
+    d->year_ = values[0];
+    return true;
+  }
+  return false;
+}
+
+
+std::shared_ptr<struct Person> parsePerson(std::span<const std::string_view> args, std::string& error) {
+  if (args.size() != 4 && args.size() != 5) {
+    error = "Person: invalid number of arguments";
+    return nullptr;
+  }
+  std::string fname(args[0]);
+  std::string lname(args[1]);
+  if (args[2] != "M" && args[2] != "F") {
+    error = "Error: sex must be either M of F";
+    return nullptr;
+  }
+  Sex sex = args[2] == "M" ? Sex::MALE : Sex::FEMALE;
+  struct Date birth = Date();
+  if (!parseDate(args[3], &birth)) {
+    error = "Error: birth date must be either dd/mm/yyyy, mm/yyyy, yyyy or ? if unknown";
+    return nullptr;
+  }
+  if (args.size() == 5) {
+    struct Date death = Date();
+    if (!parseDate(args[4], &death)) {
+      error = "Error: death date must be either dd/mm/yyyy, mm/yyyy, yyyy or ? if unknown";
+      return nullptr;
+    }
+    return memory::makeShared<struct Person, memory::PEOPLE>(fname, lname, sex, birth, death);
+  }
+  return memory::makeShared<struct Person, memory::PEOPLE>(fname, lname, sex, birth);
+}
+
+
+void parseLine(std::string_view line, char sep, std::vector<std::string_view>& tokens) {
+  size_t end = 0;
+  while (end < line.size() && line[end] == sep)
+    end++;
+  while (end < line.size()) {
+    size_t start = end;
+    while (end < line.size() && line[end] != sep)
+      end++;
+    tokens.push_back(line.substr(start, end - start));
+    while (end < line.size() && line[end] == sep)
+      end++;
+  }
+}
+
+std::vector<std::string_view> parseLine(std::string_view line, char sep) {
+  std::vector<std::string_view> tokens;
+  parseLine(line, sep, tokens);
+  return tokens;
+}
+
+int parseId(std::string_view arg) {
+  int id;
+  if (parseInts(arg, &id, 1) != 1) {
+     return -1;
+  }
+  return id;
+}
+
+std::vector<std::shared_ptr<struct Person>> parseFile(std::ifstream& in, std::string& error) {
+  std::vector<std::shared_ptr<struct Person>> res;
+  std::string line;
+  int n;
+  in >> n;
+  std::getline(in, line);
+  if (!in.good()) {
+    in.close();
+    error = "File is invalid or corrupted";
+    return {};
+  }
+  for (int i = 0; i < n; ++i) {
+    std::getline(in, line);
+    std::vector<std::string_view> args = parseLine(line, ' ');
+    std::shared_ptr<struct Person> p = parsePerson(args, error);
+    if (!p) {
+      in.close();
+      return {};
+    }
+    res.push_back(p);
+  }
+  for (int i = 0; i < n; ++i) {
+    std::getline(in, line);
+    int id1, id2;
+    if (sscanf(line.c_str(), "%d %d\n", &id1, &id2) != 2) {
+      in.close();
+      error = "File is invalid or corrupted";
+      return {};
+    }
+    if (id1 >= 0 && id1 < n) {
+      res[i]->father_ = id1;
+      res[id1]->children_.push_back(i);
+    }
+    if (id2 >= 0 && id2 < n) {
+      res[i]->mother_ = id2;
+      res[id2]->children_.push_back(i);
+    }
+  }
+  in.close();
+  return res;
+}
+
+// depth-first exploration, children first then the person then their parents
+// the stack is explicit so that deep trees do not overflow the call stack
+void treeExplore(
+  Tree& tree,
+  std::shared_ptr<struct Person> start,
+  memory::vector<std::pair<int, std::shared_ptr<struct Person>>, memory::TRAVERSALS>& list,
+  memory::vector<bool, memory::TRAVERSALS>& map
+) {
+  struct Frame {
+    std::shared_ptr<struct Person> p;
+    int level;
+    size_t next;
+  };
+  memory::vector<Frame, memory::TRAVERSALS> stack;
+  auto visit = [&](const std::shared_ptr<struct Person>& p, int level) {
+    if (!p || map[p->id])
+      return;
+    map[p->id] = true;
+    stack.push_back({ p, level, 0 });
+  };
+  visit(start, 0);
+  while (stack.size()) {
+    std::shared_ptr<struct Person> p = stack.back().p;
+    int level = stack.back().level;
+    size_t next = stack.back().next++;
+    if (next < p->children_.size()) {
+      visit(tree.person(p->children_[next]), level + 1);
+    } else if (next == p->children_.size()) {
+      list.push_back(std::make_pair(level, p));
+      visit(tree.person(p->father_), level - 1);
+    } else if (next == p->children_.size() + 1) {
+      visit(tree.person(p->mother_), level - 1);
+    } else {
+      stack.pop_back();
+    }
+  }
+}
+
+std::vector<std::vector<std::shared_ptr<struct Person>>> generations(Tree& tree, std::shared_ptr<struct Person> start) {
+  memory::vector<std::pair<int, std::shared_ptr<struct Person>>, memory::TRAVERSALS> people;
+  memory::vector<bool, memory::TRAVERSALS> travelMap(tree.size(), false);
+  treeExplore(tree, start, people, travelMap);
+  int minGen = 0;
+  int maxGen = 0;
+  for (auto& person : people) {
+    if (person.first < minGen)
+      minGen = person.first;
+    if (person.first > maxGen)
+      maxGen = person.first;
+  }
+  auto res = std::vector<std::vector<std::shared_ptr<struct Person>>>(
+    maxGen - minGen + 1, 
+    std::vector<std::shared_ptr<struct Person>>()
+  );
+  for (auto& person : people) {
+    res[person.first - minGen].push_back(person.second);
+  }
+  return res;
+}
+
+} // namespace utils
+
+} // namespace genea
\ No newline at end of file
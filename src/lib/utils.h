@@ -0,0 +1,34 @@
+#pragma once
+
+#include "person.h"
+#include "status.h"
+#include <vector>
+#include <string>
+#include <string_view>
+#include <span>
+#include <memory>
+#include <fstream>
+
+namespace genea {
+
+class Tree;
+
+namespace utils {
+
+// links are read through the tree and changed through it, the people a
+// relation reads are added to read, if given
+std::vector<std::shared_ptr<struct Person>> computeRelation(Tree& tree, std::string_view relations, std::shared_ptr<struct Person> start, Status& status, std::vector<std::shared_ptr<struct Person>>* read = nullptr);
+std::pair<std::string_view, std::string_view> splitRelation(std::string_view relations);
+bool setRelation(Tree& tree, std::string_view relation, std::shared_ptr<struct Person> p, std::shared_ptr<struct Person> other, Status& status);
+bool rmRelation(Tree& tree, std::string_view relation, std::shared_ptr<struct Person> p, Status& status);
+std::shared_ptr<struct Person> parsePerson(std::span<const std::string_view> args, std::string& error);
+bool parseDate(std::string_view s, struct Date* d);
+void parseLine(std::string_view line, char sep, std::vector<std::string_view>& tokens);
+std::vector<std::string_view> parseLine(std::string_view line, char sep);
+int parseId(std::string_view arg);
+std::vector<std::shared_ptr<struct Person>> parseFile(std::ifstream& in, std::string& error);
+std::vector<std::vector<std::shared_ptr<struct Person>>> generations(Tree& tree, std::shared_ptr<struct Person> start);
+
+} // namespace utils
+
+} // namespace genea
@@ -5,15 +5,21 @@ void help(char *argv0) {
   std::cerr << "Usage:" << std::endl;
   std::cerr << '\t' << argv0 << "\t\t\t\t # Starts a new empty tree" << std::endl;
   std::cerr << '\t' << argv0 << " [/path/to/file.genea]\t # Loads an existing tree" << std::endl;
+  std::cerr << '\t' << argv0 << " --lazy /path/to/file.genea\t # Opens an existing tree, people are only read when reached" << std::endl;
   std::cerr << '\t' << argv0 << " [-h | --help]\t\t # Prints this message" << std::endl;
 }
 
 
 int main(int argc, char **argv) {
-  if (argc > 2) {
+  if (argc > 3 || (argc == 3 && std::string(argv[1]) != "--lazy")) {
     help(argv[0]);
     return 1;
   }
+  if (argc == 3) {
+    genea::CLI cli = genea::CLI(argv[2], true);
+    cli.run();
+    return 0;
+  }
   if (argc == 2) {
     std::string arg(argv[1]);
     if (arg == "-h" || arg == "--help") {
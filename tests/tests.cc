@@ -0,0 +1,251 @@
+#include "tree.h"
+#include "archive.h"
+#include "merkle.h"
+
+#include <iostream>
+#include <fstream>
+#include <filesystem>
+#include <functional>
+#include <string>
+#include <string_view>
+#include <random>
+#include <algorithm>
+#include <unistd.h>
+
+using namespace genea;
+
+/*
+ * Checks of the library, one test per ctest entry: tests <name>
+ * Trees are random .genea files written to a temporary directory
+ */
+
+static int failures = 0;
+
+#define CHECK(condition) \
+  do { \
+    if (!(condition)) { \
+      std::cerr << __FILE__ << ":" << __LINE__ << ": check failed: " #condition << std::endl; \
+      failures++; \
+    } \
+  } while (0)
+
+static std::string path(std::string_view name) {
+  static std::filesystem::path dir = [] {
+    auto res = std::filesystem::temp_directory_path() / ("genea-tests-" + std::to_string(getpid()));
+    std::filesystem::create_directories(res);
+    return res;
+  }();
+  return (dir / name).string();
+}
+
+// parents have lower ids, some people have none and some a single one
+static std::string sample(std::string_view name, size_t n, unsigned seed) {
+  static const char* firstNames[] = { "Anne", "Louis", "Marie", "Paul", "Jane", "John" };
+  static const char* lastNames[] = { "Martin", "Durand", "Petit", "Leroy" };
+  std::mt19937 random(seed);
+  std::string file = path(name);
+  std::ofstream out(file);
+  out << n << std::endl;
+  for (size_t i = 0; i < n; ++i) {
+    out << firstNames[random() % 6] << ' ' << lastNames[random() % 4] << ' ' << (i % 2 ? 'F' : 'M') << ' ';
+    out << 1500 + random() % 400;
+    if (random() % 3)
+      out << ' ' << 1900 + random() % 100;
+    out << std::endl;
+  }
+  for (size_t i = 0; i < n; ++i) {
+    int father = -1, mother = -1;
+    if (i >= 2 && random() % 8) {
+      father = random() % (i / 2) * 2;
+      mother = random() % 4 ? random() % (i / 2) * 2 + 1 : -1;
+    }
+    out << father << ' ' << mother << std::endl;
+  }
+  return file;
+}
+
+static void archiveRoundTrip() {
+  std::string file = sample("archive.genea", 5000, 1);
+  Tree tree;
+  CHECK(tree.open(file));
+  merkle::Hash digest = tree.hashes().tree;
+  CHECK(tree.dump(path("archive.geneaz"), true));
+  Tree archived;
+  Result<size_t> opened = archived.open(path("archive.geneaz"));
+  CHECK(opened && opened.value == tree.size());
+  CHECK(archived.hashes().tree == digest);
+
+  // a truncated archive and one claiming too many people are refused
+  std::ifstream in(path("archive.geneaz"), std::ios::binary);
+  std::string data((std::istreambuf_iterator<char>(in)), std::istreambuf_iterator<char>());
+  std::ofstream(path("truncated.geneaz"), std::ios::binary) << data.substr(0, data.size() / 2);
+  std::string error;
+  CHECK(archive::read(path("truncated.geneaz"), error).empty() && !error.empty());
+  size_t count = 8;
+  while (data[count] & 0x80)
+    count++;
+  std::string huge = data.substr(0, 8) + std::string("\xff\xff\xff\xff\xff\xff\xff\x0f", 8) + data.substr(count + 1);
+  std::ofstream(path("huge.geneaz"), std::ios::binary) << huge;
+  error.clear();
+  CHECK(archive::read(path("huge.geneaz"), error).empty() && !error.empty());
+
+  // a few bytes declaring a terabyte are refused before it is allocated,
+  // whether as a block or as the dictionary
+  auto varint = [](uint64_t v) {
+    std::string res;
+    for (; v >= 0x80; v >>= 7)
+      res += (char)(v | 0x80);
+    return res + (char)v;
+  };
+  uint64_t tera = (uint64_t)1 << 40;
+  std::string bomb = varint(tera) + varint(1) + 'x' + varint(tera - 1) + varint(1) + varint(0) + varint(0);
+  std::string raw;
+  CHECK(!archive::decompress(bomb, raw, 1 << 20) && raw.empty());
+  std::string dict = archive::compress(varint(1) + varint(1) + 'A');
+  for (std::string bombed : { varint(bomb.size()) + bomb + varint(dict.size()) + dict, varint(dict.size()) + dict + varint(bomb.size()) + bomb }) {
+    std::ofstream(path("bomb.geneaz"), std::ios::binary) << data.substr(0, 8) + varint(1) + varint(1) + bombed;
+    error.clear();
+    CHECK(archive::read(path("bomb.geneaz"), error).empty() && !error.empty());
+  }
+  tree.close();
+  archived.close();
+}
+
+// a fork keeps the people it was made with, whichever of both trees changes,
+// and only copies the ones it changes
+static void forkIsolation() {
+  const memory::Counter& people = memory::counter(memory::PEOPLE);
+  long before = people.bytes;
+  Tree tree;
+  CHECK(tree.open(sample("fork.genea", 2000, 2)));
+  long opened = people.bytes - before;
+  merkle::Hash digest = tree.hashes().numbered;
+  int child = 1500;
+  while (tree.person(child)->father_ == -1)
+    child++;
+  Tree fork = tree.fork();
+  struct Person fields("Edited", "Person", Sex::MALE, Date(1950));
+  before = people.bytes;
+  fork.overwrite(fork.person(10), fields);
+  CHECK(people.bytes - before < opened / 50);
+  CHECK(fork.detach(fork.person(child), "father"));
+  fork.remove(20);
+  CHECK(tree.hashes().numbered == digest);
+  CHECK(tree.size() == 2000 && fork.size() == 1999);
+  CHECK(tree.person(10)->firstName_ != "Edited" && fork.person(10)->firstName_ == "Edited");
+  CHECK(tree.person(child)->father_ != -1 && fork.person(child - 1)->father_ == -1);
+
+  Tree other = tree.fork();
+  tree.create(fields);
+  CHECK(other.hashes().numbered == digest);
+  CHECK(tree.size() == 2001 && other.size() == 2000);
+}
+
+// people go with the last tree holding them
+static void release() {
+  const memory::Counter& people = memory::counter(memory::PEOPLE);
+  long before = people.bytes;
+  {
+    Tree tree;
+    CHECK(tree.open(sample("release.genea", 2000, 3)));
+    CHECK(people.bytes > before);
+    Tree fork = tree.fork();
+    Tree moved = std::move(fork);
+    moved.remove(0);
+    Tree assigned;
+    CHECK(assigned.open(sample("assigned.genea", 100, 4)));
+    assigned = tree.fork();
+  }
+  CHECK(people.bytes == before);
+}
+
+// a patch from a to b turns a into a tree with the digest of b
+static void diffPatch() {
+  const memory::Counter& people = memory::counter(memory::PEOPLE);
+  long before = people.bytes;
+  {
+    std::string file = sample("a.genea", 3000, 5);
+    Tree edited;
+    CHECK(edited.open(file));
+    struct Person fields("Edited", "Person", Sex::FEMALE, Date(1950, 4));
+    edited.overwrite(edited.person(42), fields);
+    edited.remove(7);
+    edited.remove(2500);
+    auto created = edited.create(fields);
+    CHECK(edited.attach(edited.person(1000), "child", created));
+    for (int id = 1200; id < 1300; ++id)
+      edited.detach(edited.person(id), "mother");
+    CHECK(edited.dump(path("b.genea")));
+    edited.close();
+
+    Tree a, b;
+    CHECK(a.open(file));
+    CHECK(b.open(path("b.genea")));
+    merkle::Patch patch = merkle::diff(a.people(), a.hashes(), b.people(), b.hashes());
+    CHECK(!patch.empty() && patch.added.size() >= 1 && patch.removed.size() >= 2);
+    CHECK(merkle::write(path("a-b.patch"), patch));
+    Result<merkle::Patch> read = merkle::read(path("a-b.patch"));
+    CHECK(read);
+    Status status = a.patch(read.value);
+    CHECK(status && status.warning.empty());
+    CHECK(a.hashes().tree == b.hashes().tree);
+    CHECK(merkle::diff(a.people(), a.hashes(), b.people(), b.hashes()).empty());
+
+    // a patch only applies to the tree it was made from
+    CHECK(!a.patch(read.value));
+  }
+  // the trees of a diff go with their people
+  CHECK(people.bytes == before);
+}
+
+// repairs leave the structural issues fixed, dates are only reported
+static void fsckRepair() {
+  std::string file = path("broken.genea");
+  std::ofstream out(file);
+  out << "5\n";
+  out << "Anne Martin F 1900\n";
+  out << "Paul Martin M 1870\n";
+  out << "John Martin M 1850\n";
+  out << "Marie Petit F 1990 1950\n";
+  out << "Louis Petit M 1920\n";
+  // 1 and 2 are fathers of each other, 3 is the father of 4
+  out << "1 3\n2 -1\n1 -1\n-1 -1\n3 -1\n";
+  out.close();
+  Tree tree;
+  CHECK(tree.open(file));
+  auto found = [](const std::vector<integrity::Issue>& issues, integrity::Kind kind) {
+    return std::any_of(issues.begin(), issues.end(), [kind](const integrity::Issue& issue) { return issue.kind == kind; });
+  };
+  std::vector<integrity::Issue> issues = tree.check();
+  CHECK(found(issues, integrity::CYCLE) && found(issues, integrity::SEX) && found(issues, integrity::DEATH));
+  issues = tree.check(true);
+  CHECK(std::all_of(issues.begin(), issues.end(), [](const integrity::Issue& issue) {
+    return issue.repaired || issue.kind == integrity::BIRTH || issue.kind == integrity::DEATH;
+  }));
+  issues = tree.check();
+  CHECK(!found(issues, integrity::CYCLE) && !found(issues, integrity::SEX) && found(issues, integrity::DEATH));
+  CHECK(tree.person(4)->mother_ == 3 && tree.person(4)->father_ == -1);
+}
+
+int main(int argc, char** argv) {
+  static const std::pair<std::string_view, std::function<void()>> tests[] = {
+    { "archive", archiveRoundTrip },
+    { "fork", forkIsolation },
+    { "release", release },
+    { "diff", diffPatch },
+    { "fsck", fsckRepair }
+  };
+  bool found = false;
+  for (auto& [name, test] : tests) {
+    if (argc < 2 || name == argv[1]) {
+      test();
+      found = true;
+    }
+  }
+  std::filesystem::remove_all(std::filesystem::path(path("")).parent_path());
+  if (!found) {
+    std::cerr << "No test named " << argv[1] << std::endl;
+    return 1;
+  }
+  return failures ? 1 : 0;
+}